@@ -0,0 +1,197 @@
+#include "BatchRenderer.h"
+#include "Singletons.h"
+#include "FileCache.h"
+#include "FileDialog.h"
+#include "MessageList.h"
+#include "session/SessionModel.h"
+#include "render/RenderSession.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <cstring>
+
+bool BatchRenderer::isRequested(int argc, char *argv[])
+{
+    for (auto i = 1; i < argc; ++i)
+        if (!std::strcmp(argv[i], "--render") ||
+            !std::strncmp(argv[i], "--render=", 9))
+            return true;
+    return false;
+}
+
+BatchRenderer::BatchRenderer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+BatchRenderer::~BatchRenderer() = default;
+
+int BatchRenderer::exec(const QStringList &arguments)
+{
+    Q_ASSERT(Singletons::headless());
+    parseArguments(arguments);
+
+    if (!Singletons::sessionModel().load(mSessionFileName)) {
+        qCritical().noquote() << "Loading session" << mSessionFileName << "failed";
+        return 1;
+    }
+    Singletons::fileCache().prefetchSessionFiles();
+
+    if (!prepareOutputs())
+        return 1;
+
+    mRenderSession.reset(new RenderSession());
+    connect(mRenderSession.data(), &RenderTask::updated,
+        this, &BatchRenderer::handleSessionRendered);
+    mRenderSession->update(true, EvaluationType::Reset);
+
+    const auto result = QCoreApplication::exec();
+    mRenderSession.reset();
+    return result;
+}
+
+void BatchRenderer::parseArguments(const QStringList &arguments)
+{
+    auto parser = QCommandLineParser();
+    parser.setApplicationDescription("Renders a session without user interface.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    const auto renderOption = QCommandLineOption("render",
+        "Session file to render.", "session");
+    const auto evaluationsOption = QCommandLineOption("evaluations",
+        "Number of evaluations (default 1).", "count", "1");
+    const auto outputOption = QCommandLineOption("output",
+        "Texture or buffer to write after the last evaluation, "
+        "by default to the file it is backed by.", "item[=file]");
+    const auto statisticsOption = QCommandLineOption("statistics",
+        "Print file cache statistics after rendering.");
+    parser.addOption(renderOption);
+    parser.addOption(evaluationsOption);
+    parser.addOption(outputOption);
+    parser.addOption(statisticsOption);
+    parser.process(arguments);
+
+    // resolve paths before loading the session changes the current directory
+    mSessionFileName = QFileInfo(parser.value(renderOption)).absoluteFilePath();
+    mEvaluationsLeft = std::max(parser.value(evaluationsOption).toInt(), 1);
+    mOutputStatistics = parser.isSet(statisticsOption);
+
+    for (const auto &output : parser.values(outputOption)) {
+        const auto separator = output.indexOf('=');
+        if (separator < 0) {
+            mOutputs += Output{ output, QString(), 0 };
+        }
+        else {
+            mOutputs += Output{ output.left(separator),
+                QFileInfo(output.mid(separator + 1)).absoluteFilePath(), 0 };
+        }
+    }
+}
+
+bool BatchRenderer::prepareOutputs()
+{
+    auto &session = Singletons::sessionModel();
+    for (auto &output : mOutputs) {
+        const FileItem *fileItem = nullptr;
+        session.forEachFileItem([&](const FileItem &item) {
+            if (!fileItem && item.name == output.itemName &&
+                (item.type == Item::Type::Texture ||
+                 item.type == Item::Type::Buffer))
+                fileItem = &item;
+        });
+
+        if (!fileItem) {
+            qCritical().noquote() << "Texture or buffer" << output.itemName << "not found";
+            return false;
+        }
+        output.itemId = fileItem->id;
+
+        if (output.fileName.isEmpty()) {
+            if (FileDialog::isEmptyOrUntitled(fileItem->fileName)) {
+                qCritical().noquote() << "No file set for" << output.itemName;
+                return false;
+            }
+            output.fileName = fileItem->fileName;
+        }
+
+        // only items backed by a file are downloaded after rendering
+        if (fileItem->fileName.isEmpty())
+            session.setData(session.getIndex(fileItem, SessionModel::FileName),
+                FileDialog::generateNextUntitledFileName(fileItem->name));
+    }
+    return true;
+}
+
+void BatchRenderer::handleSessionRendered()
+{
+    if (--mEvaluationsLeft > 0) {
+        mRenderSession->update(false, EvaluationType::Manual);
+        return;
+    }
+
+    outputMessages();
+    const auto succeeded = writeOutputs();
+    if (mOutputStatistics)
+        outputStatistics();
+    QCoreApplication::exit(succeeded ? 0 : 1);
+}
+
+bool BatchRenderer::writeOutputs()
+{
+    auto &session = Singletons::sessionModel();
+    auto &fileCache = Singletons::fileCache();
+    auto succeeded = true;
+    for (const auto &output : qAsConst(mOutputs)) {
+        auto written = false;
+        if (auto texture = session.findItem<Texture>(output.itemId)) {
+            auto data = TextureData();
+            written = (fileCache.getTexture(texture->fileName, &data) &&
+                       data.save(output.fileName, data.flippedVertically()));
+        }
+        else if (auto buffer = session.findItem<Buffer>(output.itemId)) {
+            auto data = QByteArray();
+            auto file = QFile(output.fileName);
+            written = (fileCache.getBinary(buffer->fileName, &data) &&
+                       file.open(QFile::WriteOnly) &&
+                       file.write(data) == data.size());
+        }
+
+        if (!written) {
+            qCritical().noquote() << "Writing" << output.itemName <<
+                "to" << output.fileName << "failed";
+            succeeded = false;
+        }
+    }
+    return succeeded;
+}
+
+void BatchRenderer::outputMessages()
+{
+    auto &session = Singletons::sessionModel();
+    for (const auto &message : MessageList::messages()) {
+        if (message->type == MessageType::CallDuration ||
+            message->text.isEmpty())
+            continue;
+
+        auto location = QString();
+        if (message->itemId) {
+            location = session.getFullItemName(message->itemId);
+        }
+        else if (!message->fileName.isEmpty()) {
+            location = FileDialog::getFileTitle(message->fileName);
+            if (message->line > 0)
+                location += ":" + QString::number(message->line);
+        }
+        qWarning().noquote() << location + ":" << message->text;
+    }
+}
+
+void BatchRenderer::outputStatistics()
+{
+    const auto statistics = Singletons::fileCache().statistics();
+    qInfo().noquote() << "File cache:" <<
+        statistics.hits << "hits," <<
+        statistics.misses << "misses," <<
+        statistics.evictions << "evictions";
+}
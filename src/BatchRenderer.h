@@ -0,0 +1,44 @@
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include "session/Item.h"
+#include <QObject>
+#include <QScopedPointer>
+
+class RenderSession;
+
+// renders a session without user interface (gpupad --render session.gpjs)
+class BatchRenderer final : public QObject
+{
+    Q_OBJECT
+public:
+    static bool isRequested(int argc, char *argv[]);
+
+    explicit BatchRenderer(QObject *parent = nullptr);
+    ~BatchRenderer() override;
+
+    int exec(const QStringList &arguments);
+
+private:
+    struct Output
+    {
+        QString itemName;
+        QString fileName;
+        ItemId itemId;
+    };
+
+    void parseArguments(const QStringList &arguments);
+    bool prepareOutputs();
+    void handleSessionRendered();
+    bool writeOutputs();
+    void outputMessages();
+    void outputStatistics();
+
+    QString mSessionFileName;
+    int mEvaluationsLeft{ 1 };
+    bool mOutputStatistics{ };
+    QList<Output> mOutputs;
+    QScopedPointer<RenderSession> mRenderSession;
+};
+
+#endif // BATCHRENDERER_H
@@ -5,8 +5,9 @@
 #include "editors/SourceEditor.h"
 #include "editors/TextureEditor.h"
 #include "editors/BinaryEditor.h"
-#include <QThread>
 #include <QTextStream>
+#include <algorithm>
+#include <limits>
 
 namespace
 {
@@ -59,13 +60,24 @@ namespace
         return true;
     }
 
-    bool loadTexture(const QString &fileName, bool flipVertically, TextureData *texture)
+    // reads a byte of every page, so a mapped file is in memory when it is used
+    void touchPages(const QByteArray &data)
+    {
+        const auto pageSize = 4096;
+        auto sum = char{ };
+        for (auto i = 0; i < data.size(); i += pageSize)
+            sum ^= data.constData()[i];
+        const volatile auto result = sum;
+        Q_UNUSED(result);
+    }
+
+    bool loadTexture(const QString &fileName, TextureData *texture)
     {
         if (!texture || FileDialog::isEmptyOrUntitled(fileName))
             return false;
 
         auto file = TextureData();
-        if (!file.load(fileName, flipVertically))
+        if (!file.load(fileName))
             return false;
 
         *texture = file;
@@ -84,47 +96,34 @@ namespace
         return true;
     }
 
-    bool isFileInUse(const QString &fileName)
+    QSet<QString> getFilesInUse()
     {
-        if (Singletons::editorManager().getEditor(fileName))
-            return true;
-        auto fileInUse = false;
+        auto filesInUse = QSet<QString>();
         Singletons::sessionModel().forEachFileItem(
-            [&](const FileItem& item) { fileInUse |= (item.fileName == fileName); });
-        return fileInUse;
+            [&](const FileItem& item) { filesInUse.insert(item.fileName); });
+        if (!Singletons::headless()) {
+            auto &editorManager = Singletons::editorManager();
+            for (const auto &fileName : editorManager.getSourceFileNames())
+                filesInUse.insert(fileName);
+            for (const auto &fileName : editorManager.getBinaryFileNames())
+                filesInUse.insert(fileName);
+            for (const auto &fileName : editorManager.getImageFileNames())
+                filesInUse.insert(fileName);
+        }
+        return filesInUse;
     }
 } // namespace
 
-class FileCache::BackgroundLoader final : public QObject 
+class FileCache::BackgroundTask final : public QRunnable
 {
-    Q_OBJECT
+public:
+    explicit BackgroundTask(std::function<void()> function)
+        : mFunction(std::move(function)) { }
 
-public Q_SLOTS:
-    void loadSource(const QString &fileName) 
-    {
-        auto source = QString();
-        if (::loadSource(fileName, &source))
-            Q_EMIT sourceLoaded(fileName, std::move(source));
-    }
+    void run() override { mFunction(); }
 
-    void loadTexture(const QString &fileName, bool flipVertically) 
-    {
-        auto texture = TextureData();
-        if (::loadTexture(fileName, flipVertically, &texture))
-            Q_EMIT textureLoaded(fileName, flipVertically, std::move(texture));
-    }
-
-    void loadBinary(const QString &fileName) 
-    {
-        auto binary = QByteArray();
-        if (::loadBinary(fileName, &binary))
-            Q_EMIT binaryLoaded(fileName, std::move(binary));
-    }
-
-Q_SIGNALS:
-    void sourceLoaded(const QString &fileName, QString source);
-    void textureLoaded(const QString &fileName, bool flipVertically, TextureData texture);
-    void binaryLoaded(const QString &fileName, QByteArray binary);
+private:
+    const std::function<void()> mFunction;
 };
 
 FileCache::FileCache(QObject *parent) 
@@ -136,27 +135,8 @@ FileCache::FileCache(QObject *parent)
         this, &FileCache::handleFileSystemFileChanged);
     connect(&mUpdateFileSystemWatchesTimer, &QTimer::timeout,
         this, &FileCache::updateFileSystemWatches);
-
-    auto backgroundLoader = new BackgroundLoader();
-    connect(this, &FileCache::reloadSource,
-        backgroundLoader, &BackgroundLoader::loadSource);
-    connect(this, &FileCache::reloadTexture,
-        backgroundLoader, &BackgroundLoader::loadTexture);
-    connect(this, &FileCache::reloadBinary,
-        backgroundLoader, &BackgroundLoader::loadBinary);
-
-    connect(backgroundLoader, &BackgroundLoader::sourceLoaded,
-        this, &FileCache::handleSourceReloaded);
-    connect(backgroundLoader, &BackgroundLoader::textureLoaded,
-        this, &FileCache::handleTextureReloaded);
-    connect(backgroundLoader, &BackgroundLoader::binaryLoaded,
-        this, &FileCache::handleBinaryReloaded);
-
-    connect(&mBackgroundLoaderThread, &QThread::finished,
-        backgroundLoader, &QObject::deleteLater);
-
-    mBackgroundLoaderThread.start();
-    backgroundLoader->moveToThread(&mBackgroundLoaderThread);
+    connect(&mUpdateFileSystemWatchesTimer, &QTimer::timeout,
+        this, &FileCache::evictUnusedFiles);
 
     mUpdateFileSystemWatchesTimer.setInterval(5);
     mUpdateFileSystemWatchesTimer.setSingleShot(false);
@@ -165,8 +145,45 @@ FileCache::FileCache(QObject *parent)
 
 FileCache::~FileCache() 
 {
-    mBackgroundLoaderThread.quit();
-    mBackgroundLoaderThread.wait();
+    mBackgroundLoaders.clear();
+    mBackgroundLoaders.waitForDone();
+}
+
+void FileCache::prefetchSessionFiles()
+{
+    Q_ASSERT(onMainThread());
+
+    // load files in parallel, the earlier in the session the higher the priority
+    auto priority = 0;
+    Singletons::sessionModel().forEachFileItem([&](const FileItem &item) {
+        const auto fileName = item.fileName;
+        if (FileDialog::isEmptyOrUntitled(fileName))
+            return;
+
+        auto prefetch = std::function<void()>();
+        if (castItem<Texture>(item)) {
+            prefetch = [this, fileName]() {
+                auto texture = TextureData();
+                getTexture(fileName, &texture);
+            };
+        }
+        else if (castItem<Buffer>(item)) {
+            prefetch = [this, fileName]() {
+                auto binary = QByteArray();
+                auto mappedFile = std::shared_ptr<const QFile>();
+                auto mappedVersion = quint64{ };
+                if (getMappedBinary(fileName, &binary, &mappedFile, &mappedVersion))
+                    touchPages(binary);
+            };
+        }
+        else {
+            prefetch = [this, fileName]() {
+                auto source = QString();
+                getSource(fileName, &source);
+            };
+        }
+        mBackgroundLoaders.start(new BackgroundTask(prefetch), priority--);
+    });
 }
 
 void FileCache::invalidateFile(const QString &fileName) 
@@ -192,6 +209,9 @@ void FileCache::handleEditorSave(const QString &fileName)
 void FileCache::updateEditorFiles()
 {
     Q_ASSERT(onMainThread());
+    if (Singletons::headless())
+        return;
+
     QMutexLocker lock(&mMutex);
 
     auto &editorManager = Singletons::editorManager();
@@ -200,11 +220,10 @@ void FileCache::updateEditorFiles()
             mSources[fileName] = editor->source();
         }
         else if (auto editor = editorManager.getBinaryEditor(fileName)) {
-            mBinaries[fileName] = editor->data();
+            updateBinary(fileName, editor->data(), editor->takeModifiedRange());
         }
         else if (auto editor = editorManager.getTextureEditor(fileName)) {
-            const auto &texture = editor->texture();
-            mTextures[TextureKey(fileName, texture.flippedVertically())] = texture;
+            mTextures[fileName] = editor->texture();
         }
         else {
             purgeFile(fileName);
@@ -213,31 +232,77 @@ void FileCache::updateEditorFiles()
     mEditorFilesChanged.clear();
 }
 
+void FileCache::replaceTexture(const QString &fileName, TextureData texture)
+{
+    Q_ASSERT(onMainThread());
+    QMutexLocker lock(&mMutex);
+    mTextures[fileName] = std::move(texture);
+}
+
+void FileCache::replaceBinary(const QString &fileName, QByteArray binary)
+{
+    Q_ASSERT(onMainThread());
+    QMutexLocker lock(&mMutex);
+    mBinaries[fileName] = std::move(binary);
+    mBinaryModifications.remove(fileName);
+    mMappedBinaries.remove(fileName);
+}
+
+void FileCache::updateBinary(const QString &fileName, QByteArray binary,
+    std::pair<int, int> modifiedRange)
+{
+    mMappedBinaries.remove(fileName);
+    auto &current = mBinaries[fileName];
+    if (current.isEmpty() || current.size() != binary.size() ||
+        modifiedRange.first >= modifiedRange.second) {
+        mBinaryModifications.remove(fileName);
+        current = std::move(binary);
+        return;
+    }
+
+    // start new modification, once the previous was read
+    auto it = mBinaryModifications.find(fileName);
+    if (it == mBinaryModifications.end() || it->read) {
+        mBinaryModifications[fileName] = { current, modifiedRange, false };
+    }
+    else {
+        it->range.first = std::min(it->range.first, modifiedRange.first);
+        it->range.second = std::max(it->range.second, modifiedRange.second);
+    }
+    current = std::move(binary);
+}
+
 bool FileCache::getSource(const QString &fileName, QString *source) const
 {
     Q_ASSERT(source);
     QMutexLocker lock(&mMutex);
 
+    waitWhileLoading(fileName);
+    countAccess(fileName, mSources.contains(fileName));
     if (mSources.contains(fileName)) {
         *source = mSources[fileName];
         return true;
     }
 
     addFileSystemWatch(fileName);
-    if (!loadSource(fileName, source))
+    if (!loadUnlocked(fileName, [&]() { return loadSource(fileName, source); }))
         return false;
-    mSources[fileName] = *source;
+    if (mSources.contains(fileName))
+        *source = mSources[fileName];
+    else
+        mSources[fileName] = *source;
     return true;
 }
 
-bool FileCache::getTexture(const QString &fileName, bool flipVertically, TextureData *texture) const
+bool FileCache::getTexture(const QString &fileName, TextureData *texture) const
 {
     Q_ASSERT(texture);
     QMutexLocker lock(&mMutex);
 
-    const auto key = TextureKey(fileName, flipVertically);
-    if (mTextures.contains(key)) {
-        *texture = mTextures[key];
+    waitWhileLoading(fileName);
+    countAccess(fileName, mTextures.contains(fileName));
+    if (mTextures.contains(fileName)) {
+        *texture = mTextures[fileName];
         return true;
     }
 
@@ -247,24 +312,38 @@ bool FileCache::getTexture(const QString &fileName, bool flipVertically, Texture
         texture->create(QOpenGLTexture::Target2D,
             QOpenGLTexture::RGB8_UNorm, 1, 1, 1, 1, 1);
         texture->clear();
-        Q_EMIT videoPlayerRequested(fileName, flipVertically);
+        Q_EMIT videoPlayerRequested(fileName);
     }
-    else if (!loadTexture(fileName, flipVertically, texture)) {
+    else if (!loadUnlocked(fileName, [&]() {
+            return loadTexture(fileName, texture); })) {
         return false;
     }
-    mTextures[key] = *texture;
+    if (mTextures.contains(fileName))
+        *texture = mTextures[fileName];
+    else
+        mTextures[fileName] = *texture;
+    return true;
+}
+
+bool FileCache::getTexture(const QString &fileName, bool flipVertically, TextureData *texture) const
+{
+    if (!getTexture(fileName, texture))
+        return false;
+
+    // a flipped copy is only created for consumers on the CPU
+    if (texture->flippedVertically() != flipVertically)
+        texture->flipVertically();
     return true;
 }
 
-bool FileCache::updateTexture(const QString &fileName, bool flippedVertically, TextureData texture) const
+bool FileCache::updateTexture(const QString &fileName, TextureData texture) const
 {
     Q_ASSERT(!texture.isNull());
     QMutexLocker lock(&mMutex);
 
-    const auto key = TextureKey(fileName, flippedVertically);
-    if (!mTextures.contains(key))
+    if (!mTextures.contains(fileName))
         return false;
-    mTextures[key] = std::move(texture);
+    mTextures[fileName] = std::move(texture);
     return true;
 }
 
@@ -273,18 +352,194 @@ bool FileCache::getBinary(const QString &fileName, QByteArray *binary) const
     Q_ASSERT(binary);
     QMutexLocker lock(&mMutex);
 
+    waitWhileLoading(fileName);
+    countAccess(fileName, mBinaries.contains(fileName));
     if (mBinaries.contains(fileName)) {
         *binary = mBinaries[fileName];
         return true;
     }
 
     addFileSystemWatch(fileName);
-    if (!loadBinary(fileName, binary))
+    if (!loadUnlocked(fileName, [&]() { return loadBinary(fileName, binary); }))
+        return false;
+    if (mBinaries.contains(fileName)) {
+        *binary = mBinaries[fileName];
+    }
+    else {
+        mBinaries[fileName] = *binary;
+        mMappedBinaries.remove(fileName);
+    }
+    return true;
+}
+
+void FileCache::waitWhileLoading(const QString &fileName) const
+{
+    while (mFilesLoading.contains(fileName))
+        mFileLoaded.wait(&mMutex);
+}
+
+template<typename Load>
+bool FileCache::loadUnlocked(const QString &fileName, Load &&load) const
+{
+    // concurrent loads of the same file wait for this one
+    mFilesLoading.insert(fileName);
+    mMutex.unlock();
+    const auto loaded = load();
+    mMutex.lock();
+    mFilesLoading.remove(fileName);
+    mFileLoaded.wakeAll();
+    return loaded;
+}
+
+bool FileCache::getMappedBinary(const QString &fileName, QByteArray *binary,
+    std::shared_ptr<const QFile> *mappedFile, quint64 *mappedVersion) const
+{
+    QMutexLocker lock(&mMutex);
+
+    // binaries which were loaded or modified by an editor are not mapped
+    if (mBinaries.contains(fileName))
         return false;
-    mBinaries[fileName] = *binary;
+
+    // the user still has the data of the version, which is not mapped again
+    auto it = mMappedBinaries.find(fileName);
+    const auto found = (it != mMappedBinaries.end());
+    if (found) {
+        countAccess(fileName, true);
+        if (it->version == *mappedVersion)
+            return true;
+    }
+
+    auto file = std::shared_ptr<const QFile>();
+    if (found)
+        file = it->file.lock();
+    if (!file) {
+        if (FileDialog::isEmptyOrUntitled(fileName))
+            return false;
+
+        auto mapping = std::make_shared<QFile>(fileName);
+        if (!mapping->open(QFile::ReadOnly) || mapping->size() <= 0 ||
+            mapping->size() > std::numeric_limits<int>::max())
+            return false;
+        const auto size = static_cast<int>(mapping->size());
+        const auto data = mapping->map(0, size);
+        if (!data)
+            return false;
+
+        // a file mapped again did not change, otherwise it would have been purged
+        file = mapping;
+        if (!found) {
+            addFileSystemWatch(fileName);
+            it = mMappedBinaries.insert(fileName, { file, { }, mNextMappedVersion++ });
+            countAccess(fileName, false);
+        }
+        it->file = file;
+        it->data = QByteArray::fromRawData(
+            reinterpret_cast<const char*>(data), size);
+    }
+    *binary = it->data;
+    *mappedFile = file;
+    *mappedVersion = it->version;
     return true;
 }
 
+bool FileCache::getBinary(const QString &fileName, QByteArray *binary,
+    const QByteArray &prevBinary, std::pair<int, int> *modifiedRange,
+    std::shared_ptr<const QFile> *mappedFile, quint64 *mappedVersion) const
+{
+    Q_ASSERT(binary && modifiedRange && mappedFile && mappedVersion);
+    if (getMappedBinary(fileName, binary, mappedFile, mappedVersion)) {
+        *modifiedRange = { 0, static_cast<int>(binary->size()) };
+        return true;
+    }
+    mappedFile->reset();
+    *mappedVersion = 0;
+
+    if (!getBinary(fileName, binary))
+        return false;
+
+    QMutexLocker lock(&mMutex);
+    *modifiedRange = { 0, static_cast<int>(binary->size()) };
+    const auto it = mBinaryModifications.find(fileName);
+    if (it != mBinaryModifications.end() &&
+        mBinaries[fileName].isSharedWith(*binary)) {
+        if (!prevBinary.isEmpty() && it->base.isSharedWith(prevBinary))
+            *modifiedRange = it->range;
+        it->read = true;
+    }
+    return true;
+}
+
+FileCache::Statistics FileCache::statistics() const
+{
+    QMutexLocker lock(&mMutex);
+    return mStatistics;
+}
+
+void FileCache::setMemoryBudget(qint64 bytes)
+{
+    Q_ASSERT(onMainThread());
+    QMutexLocker lock(&mMutex);
+    mMemoryBudget = bytes;
+    mEvictionPending = true;
+}
+
+void FileCache::countAccess(const QString &fileName, bool hit) const
+{
+    mFileLastAccess[fileName] = ++mAccessCounter;
+    if (hit) {
+        ++mStatistics.hits;
+    }
+    else {
+        ++mStatistics.misses;
+        mEvictionPending = true;
+    }
+}
+
+void FileCache::evictUnusedFiles()
+{
+    Q_ASSERT(onMainThread());
+    QMutexLocker lock(&mMutex);
+    if (!std::exchange(mEvictionPending, false) || mMemoryBudget <= 0)
+        return;
+
+    auto fileSizes = QHash<QString, qint64>();
+    for (auto it = mSources.cbegin(); it != mSources.cend(); ++it)
+        fileSizes[it.key()] += it->size() * static_cast<qint64>(sizeof(QChar));
+    for (auto it = mBinaries.cbegin(); it != mBinaries.cend(); ++it)
+        fileSizes[it.key()] += it->size();
+    for (auto it = mBinaryModifications.cbegin(); it != mBinaryModifications.cend(); ++it)
+        fileSizes[it.key()] += it->base.size();
+    for (auto it = mMappedBinaries.cbegin(); it != mMappedBinaries.cend(); ++it)
+        if (!it->file.expired())
+            fileSizes[it.key()] += it->data.size();
+    for (auto it = mTextures.cbegin(); it != mTextures.cend(); ++it)
+        fileSizes[it.key()] += it->getDataSize();
+
+    auto totalSize = qint64{ };
+    for (const auto &size : qAsConst(fileSizes))
+        totalSize += size;
+    if (totalSize <= mMemoryBudget)
+        return;
+
+    // evict least recently accessed files first
+    auto fileNames = fileSizes.keys();
+    std::sort(fileNames.begin(), fileNames.end(),
+        [&](const QString &a, const QString &b) {
+            return (mFileLastAccess.value(a) < mFileLastAccess.value(b));
+        });
+
+    const auto filesInUse = getFilesInUse();
+    for (const auto &fileName : qAsConst(fileNames)) {
+        if (totalSize <= mMemoryBudget)
+            break;
+        if (filesInUse.contains(fileName))
+            continue;
+        purgeFile(fileName);
+        totalSize -= fileSizes[fileName];
+        ++mStatistics.evictions;
+    }
+}
+
 void FileCache::handleFileSystemFileChanged(const QString &fileName)
 {
     Q_ASSERT(onMainThread());
@@ -324,31 +579,79 @@ void FileCache::updateFileSystemWatches()
 
 bool FileCache::reloadFileInBackground(const QString &fileName) 
 {
-    if (mSources.contains(fileName)) {
-        Q_EMIT reloadSource(fileName, QPrivateSignal());
+    // coalesce with running reload, which is repeated when finished
+    if (mFilesReloading.contains(fileName)) {
+        mFilesReloading[fileName] = true;
         return true;
     }
-    if (mTextures.contains({ fileName, true })) {
-        Q_EMIT reloadTexture(fileName, true, QPrivateSignal());
+
+    if (mSources.contains(fileName)) {
+        startReload(fileName, [this, fileName]() {
+            auto source = QString();
+            if (::loadSource(fileName, &source))
+                QMetaObject::invokeMethod(this, [this, fileName, source]() {
+                    handleSourceReloaded(fileName, source);
+                }, Qt::QueuedConnection);
+        });
         return true;
-    } 
-    if (mTextures.contains({ fileName, false })) {
-        Q_EMIT reloadTexture(fileName, false, QPrivateSignal());
+    }
+    if (mTextures.contains(fileName)) {
+        startReload(fileName, [this, fileName]() {
+            auto texture = TextureData();
+            if (::loadTexture(fileName, &texture))
+                QMetaObject::invokeMethod(this, [this, fileName, texture]() {
+                    handleTextureReloaded(fileName, texture);
+                }, Qt::QueuedConnection);
+        });
         return true;
-    } 
+    }
     if (mBinaries.contains(fileName)) {
-        Q_EMIT reloadBinary(fileName, QPrivateSignal());
+        startReload(fileName, [this, fileName]() {
+            auto binary = QByteArray();
+            if (::loadBinary(fileName, &binary))
+                QMetaObject::invokeMethod(this, [this, fileName, binary]() {
+                    handleBinaryReloaded(fileName, binary);
+                }, Qt::QueuedConnection);
+        });
         return true;
     }
     return false;
 }
 
+void FileCache::startReload(const QString &fileName, std::function<void()> reload)
+{
+    mFilesReloading[fileName] = false;
+    mBackgroundLoaders.start(new BackgroundTask([this, fileName, reload]() {
+        reload();
+        QMetaObject::invokeMethod(this, [this, fileName]() {
+            finishReload(fileName);
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void FileCache::finishReload(const QString &fileName)
+{
+    Q_ASSERT(onMainThread());
+    QMutexLocker lock(&mMutex);
+    if (!mFilesReloading.take(fileName))
+        return;
+
+    // file changed again while it was reloaded
+    if (!reloadFileInBackground(fileName)) {
+        purgeFile(fileName);
+        lock.unlock();
+        Q_EMIT fileChanged(fileName);
+    }
+}
+
 void FileCache::purgeFile(const QString &fileName)
 {
     mSources.remove(fileName);
     mBinaries.remove(fileName);
-    mTextures.remove(TextureKey(fileName, true));
-    mTextures.remove(TextureKey(fileName, false));
+    mBinaryModifications.remove(fileName);
+    mMappedBinaries.remove(fileName);
+    mTextures.remove(fileName);
+    mFileLastAccess.remove(fileName);
 }
 
 void FileCache::handleSourceReloaded(const QString &fileName, QString source) 
@@ -359,22 +662,24 @@ void FileCache::handleSourceReloaded(const QString &fileName, QString source)
     mSources[fileName] = source;
     lock.unlock();
 
-    if (auto editor = Singletons::editorManager().getSourceEditor(fileName))
-        editor->load();
+    if (!Singletons::headless())
+        if (auto editor = Singletons::editorManager().getSourceEditor(fileName))
+            editor->load();
 
     Q_EMIT fileChanged(fileName);
 }
 
-void FileCache::handleTextureReloaded(const QString &fileName, bool flipVertically, TextureData texture) 
+void FileCache::handleTextureReloaded(const QString &fileName, TextureData texture) 
 {
     Q_ASSERT(onMainThread());
     QMutexLocker lock(&mMutex);
 
-    mTextures[TextureKey(fileName, flipVertically)] = texture;
+    mTextures[fileName] = texture;
     lock.unlock();
 
-    if (auto editor = Singletons::editorManager().getTextureEditor(fileName))
-        editor->load();
+    if (!Singletons::headless())
+        if (auto editor = Singletons::editorManager().getTextureEditor(fileName))
+            editor->load();
     
     Q_EMIT fileChanged(fileName);
 }
@@ -385,12 +690,13 @@ void FileCache::handleBinaryReloaded(const QString &fileName, QByteArray binary)
     QMutexLocker lock(&mMutex);
 
     mBinaries[fileName] = binary;
+    mBinaryModifications.remove(fileName);
+    mMappedBinaries.remove(fileName);
     lock.unlock();
 
-    if (auto editor = Singletons::editorManager().getBinaryEditor(fileName))
-        editor->load();
+    if (!Singletons::headless())
+        if (auto editor = Singletons::editorManager().getBinaryEditor(fileName))
+            editor->load();
 
     Q_EMIT fileChanged(fileName);
 }
-
-#include "FileCache.moc"
@@ -3,64 +3,123 @@
 
 #include <QObject>
 #include <QMap>
+#include <QHash>
 #include <QSet>
 #include <QMutex>
 #include <QTimer>
-#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
 #include <QFileSystemWatcher>
 #include "TextureData.h"
+#include <functional>
+#include <memory>
+#include <utility>
+
+class QFile;
 
 class FileCache final : public QObject
 {
     Q_OBJECT
 public:
+    struct Statistics
+    {
+        qint64 hits;
+        qint64 misses;
+        qint64 evictions;
+    };
+
     explicit FileCache(QObject *parent = nullptr);
     ~FileCache();
 
     bool getSource(const QString &fileName, QString *source) const;
+    // texture is returned in the orientation it is cached in
+    bool getTexture(const QString &fileName, TextureData *texture) const;
     bool getTexture(const QString &fileName, bool flipVertically, TextureData *texture) const;
     bool getBinary(const QString &fileName, QByteArray *binary) const;
-    bool updateTexture(const QString &fileName, bool flippedVertically, TextureData texture) const;
+    bool getBinary(const QString &fileName, QByteArray *binary,
+        const QByteArray &prevBinary, std::pair<int, int> *modifiedRange,
+        std::shared_ptr<const QFile> *mappedFile, quint64 *mappedVersion) const;
+    bool updateTexture(const QString &fileName, TextureData texture) const;
+    Statistics statistics() const;
 
     // only call from main thread
+    void setMemoryBudget(qint64 bytes);
+    void prefetchSessionFiles();
     void invalidateFile(const QString &fileName);
     void handleEditorFileChanged(const QString &fileName, bool emitFileChanged = true);
     void handleEditorSave(const QString &fileName);
     void updateEditorFiles();
+    void replaceTexture(const QString &fileName, TextureData texture);
+    void replaceBinary(const QString &fileName, QByteArray binary);
 
 Q_SIGNALS:
     void fileChanged(const QString &fileName);
-    void videoPlayerRequested(const QString &fileName, bool flipVertically) const;
-    void reloadSource(const QString &fileName, QPrivateSignal);
-    void reloadTexture(const QString &fileName, bool flipVertically, QPrivateSignal);
-    void reloadBinary(const QString &fileName, QPrivateSignal);
+    void videoPlayerRequested(const QString &fileName) const;
 
 public Q_SLOTS:
     void handleSourceReloaded(const QString &fileName, QString);
-    void handleTextureReloaded(const QString &fileName, bool flipVertically, TextureData);
+    void handleTextureReloaded(const QString &fileName, TextureData);
     void handleBinaryReloaded(const QString &fileName, QByteArray);
 
 private:
-    class BackgroundLoader;
-    using TextureKey = QPair<QString, bool>;
+    class BackgroundTask;
+
+    // binary differs from base only within range
+    struct BinaryModification
+    {
+        QByteArray base;
+        std::pair<int, int> range;
+        bool read;
+    };
+
+    // binary referencing a read-only memory mapping of the file,
+    // which is only valid as long as the file is referenced by a user
+    struct MappedBinary
+    {
+        std::weak_ptr<const QFile> file;
+        QByteArray data;
+        quint64 version;
+    };
 
     void handleFileSystemFileChanged(const QString &fileName);
     void addFileSystemWatch(const QString &fileName, bool changed = false) const;
     void updateFileSystemWatches();
     bool reloadFileInBackground(const QString &fileName);
+    void startReload(const QString &fileName, std::function<void()> reload);
+    void finishReload(const QString &fileName);
+    void waitWhileLoading(const QString &fileName) const;
+    template<typename Load>
+    bool loadUnlocked(const QString &fileName, Load &&load) const;
     void purgeFile(const QString &fileName);
+    void updateBinary(const QString &fileName, QByteArray binary,
+        std::pair<int, int> modifiedRange);
+    bool getMappedBinary(const QString &fileName, QByteArray *binary,
+        std::shared_ptr<const QFile> *mappedFile, quint64 *mappedVersion) const;
+    void countAccess(const QString &fileName, bool hit) const;
+    void evictUnusedFiles();
 
     mutable QMutex mMutex;
     mutable QMap<QString, QString> mSources;
-    mutable QMap<TextureKey, TextureData> mTextures;
+    mutable QMap<QString, TextureData> mTextures;
     mutable QMap<QString, QByteArray> mBinaries;
+    mutable QMap<QString, BinaryModification> mBinaryModifications;
+    mutable QMap<QString, MappedBinary> mMappedBinaries;
+    mutable quint64 mNextMappedVersion{ 1 };
     mutable QMap<QString, bool> mFileSystemWatchesToAdd;
+    mutable QSet<QString> mFilesLoading;
+    mutable QWaitCondition mFileLoaded;
+    mutable QHash<QString, quint64> mFileLastAccess;
+    mutable quint64 mAccessCounter{ };
+    mutable Statistics mStatistics{ };
+    mutable bool mEvictionPending{ };
+    qint64 mMemoryBudget{ };
 
     QSet<QString> mEditorFilesChanged;
     QSet<QString> mEditorSaveAdvertised;
+    QMap<QString, bool> mFilesReloading;
     QTimer mUpdateFileSystemWatchesTimer;
     QFileSystemWatcher mFileSystemWatcher;
-    QThread mBackgroundLoaderThread;
+    QThreadPool mBackgroundLoaders;
 };
 
 #endif // FILECACHE_H
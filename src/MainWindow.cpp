@@ -240,6 +240,8 @@ MainWindow::MainWindow(QWidget *parent)
         &settings, &Settings::setLineWrap);
     connect(mUi->actionIndentWithSpaces, &QAction::toggled,
         &settings, &Settings::setIndentWithSpaces);
+    connect(mUi->actionTrackMemoryBarriers, &QAction::toggled,
+        &settings, &Settings::setTrackMemoryBarriers);
     connect(&settings, &Settings::darkThemeChanging,
         this, &MainWindow::handleDarkThemeChanging);
 
@@ -338,6 +340,7 @@ void MainWindow::readSettings()
     mUi->actionShowWhiteSpace->setChecked(settings.showWhiteSpace());
     mUi->actionDarkTheme->setChecked(settings.darkTheme());
     mUi->actionLineWrapping->setChecked(settings.lineWrap());
+    mUi->actionTrackMemoryBarriers->setChecked(settings.trackMemoryBarriers());
     mUi->actionFullScreen->setChecked(isFullScreen());
     handleDarkThemeChanging(settings.darkTheme());
 }
@@ -1,10 +1,101 @@
 #include "MessageList.h"
 #include <QMutex>
+#include <QMultiHash>
+#include <QPair>
+#include <algorithm>
+#include <utility>
 
 namespace {
+    using MessageKey = QPair<int, QString>;
+
     QMutex gMessagesMutex;
     QList<QWeakPointer<const Message>> gMessages;
+    // index for deduplication, expired entries are removed lazily
+    QMultiHash<MessageKey, QWeakPointer<const Message>> gMessagesByKey;
     qulonglong gNextMessageId = 1;
+    const auto minPruneThreshold = 64;
+    auto gPruneThreshold = minPruneThreshold;
+
+    // changes are only recorded while a change handler is set
+    QMutex gChangesMutex;
+    std::function<void()> gChangeHandler;
+    QList<QWeakPointer<const Message>> gAddedMessages;
+    QList<MessageId> gRemovedMessageIds;
+
+    template<typename F>
+    void recordChange(F &&record)
+    {
+        QMutexLocker lock(&gChangesMutex);
+        if (!gChangeHandler)
+            return;
+
+        // handler is only called for the first change since last taken
+        const auto notify = (gAddedMessages.isEmpty() &&
+                             gRemovedMessageIds.isEmpty());
+        record();
+        if (notify) {
+            const auto handler = gChangeHandler;
+            lock.unlock();
+            handler();
+        }
+    }
+
+    void deleteMessage(const Message *message)
+    {
+        const auto id = message->id;
+        delete message;
+        recordChange([&]() { gRemovedMessageIds.append(id); });
+    }
+
+    template<typename Predicate>
+    MessagePtr findMessage(MessageType type, const QString &text,
+        const Predicate &predicate)
+    {
+        const auto key = MessageKey(type, text);
+        auto it = gMessagesByKey.find(key);
+        while (it != gMessagesByKey.end() && it.key() == key) {
+            if (MessagePtr message = it.value().lock()) {
+                if (predicate(*message))
+                    return message;
+                ++it;
+            }
+            else {
+                it = gMessagesByKey.erase(it);
+            }
+        }
+        return { };
+    }
+
+    void removeExpiredMessages()
+    {
+        gMessages.erase(std::remove_if(gMessages.begin(), gMessages.end(),
+            [](const QWeakPointer<const Message> &message) {
+                return message.isNull();
+            }), gMessages.end());
+
+        for (auto it = gMessagesByKey.begin(); it != gMessagesByKey.end(); ) {
+            if (it.value().isNull())
+                it = gMessagesByKey.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    MessagePtr addMessage(Message &&message)
+    {
+        // prune amortized, messages like call durations expire constantly
+        if (gMessages.size() >= gPruneThreshold) {
+            removeExpiredMessages();
+            gPruneThreshold = std::max(minPruneThreshold,
+                2 * static_cast<int>(gMessages.size()));
+        }
+
+        auto ptr = MessagePtr(new Message(std::move(message)), deleteMessage);
+        gMessages.append(ptr);
+        gMessagesByKey.insert(MessageKey(ptr->type, ptr->text), ptr);
+        recordChange([&]() { gAddedMessages.append(ptr); });
+        return ptr;
+    }
 } // namespace
 
 namespace MessageList {
@@ -14,18 +105,15 @@ MessagePtr insert(QString fileName, int line,
 {
     QMutexLocker lock(&gMessagesMutex);
     if (deduplicate) {
-        for (const auto &ptr : qAsConst(gMessages))
-            if (MessagePtr message = ptr.lock())
-                if (message->fileName == fileName &&
-                    message->line == line &&
-                    message->type == type &&
-                    message->text == text)
-                    return message;
+        const auto message = findMessage(type, text,
+            [&](const Message &message) {
+                return (message.fileName == fileName &&
+                        message.line == line);
+            });
+        if (message)
+            return message;
     }
-    auto message = MessagePtr(new Message{
-        gNextMessageId++, type, text, 0, fileName, line });
-    gMessages.append(message);
-    return message;
+    return addMessage({ gNextMessageId++, type, text, 0, fileName, line });
 }
 
 MessagePtr insert(ItemId itemId,
@@ -33,31 +121,44 @@ MessagePtr insert(ItemId itemId,
 {
     QMutexLocker lock(&gMessagesMutex);
     if (deduplicate) {
-        for (const QWeakPointer<const Message> &ptr : qAsConst(gMessages))
-            if (MessagePtr message = ptr.lock())
-                if ((!itemId || message->itemId == itemId) &&
-                    message->type == type &&
-                    message->text == text)
-                    return message;
+        const auto message = findMessage(type, text,
+            [&](const Message &message) {
+                return (!itemId || message.itemId == itemId);
+            });
+        if (message)
+            return message;
     }
-    auto message = MessagePtr(new Message{
-        gNextMessageId++, type, text, itemId, QString(), 0 });
-    gMessages.append(message);
-    return message;
+    return addMessage({ gNextMessageId++, type, text, itemId, QString(), 0 });
 }
 
 QList<MessagePtr> messages()
 {
     QMutexLocker lock(&gMessagesMutex);
+    removeExpiredMessages();
     auto result = QList<MessagePtr>();
-    QMutableListIterator<QWeakPointer<const Message>> it(gMessages);
-    while (it.hasNext()) {
-        if (MessagePtr message = it.next().lock())
+    result.reserve(gMessages.size());
+    for (const auto &ptr : qAsConst(gMessages))
+        if (MessagePtr message = ptr.lock())
             result += message;
-        else
-            it.remove();
-    }
     return result;
 }
 
+void setChangeHandler(std::function<void()> handler)
+{
+    QMutexLocker lock(&gChangesMutex);
+    gChangeHandler = std::move(handler);
+    gAddedMessages.clear();
+    gRemovedMessageIds.clear();
+}
+
+void takeChanges(QList<MessagePtr> *added, QList<MessageId> *removed)
+{
+    QMutexLocker lock(&gChangesMutex);
+    for (const auto &ptr : qAsConst(gAddedMessages))
+        if (MessagePtr message = ptr.lock())
+            added->append(message);
+    gAddedMessages.clear();
+    *removed = std::exchange(gRemovedMessageIds, { });
+}
+
 } // namespace
@@ -4,6 +4,7 @@
 #include <QSharedPointer>
 #include <QString>
 #include <QSet>
+#include <functional>
 
 using ItemId = int;
 using MessageId = qulonglong;
@@ -60,6 +61,11 @@ namespace MessageList
     MessagePtr insert(ItemId itemId, MessageType type,
         QString text = "", bool deduplicate = true);
     QList<MessagePtr> messages();
+
+    // handler is called from any thread, when changes become available
+    void setChangeHandler(std::function<void()> handler);
+    // messages added and ids of messages removed since the last call
+    void takeChanges(QList<MessagePtr> *added, QList<MessageId> *removed);
 };
 
 #endif // MESSAGELIST_H
@@ -4,6 +4,8 @@
 #include "session/SessionModel.h"
 #include "FileDialog.h"
 #include <QTimer>
+#include <QPointer>
+#include <QCoreApplication>
 #include <QHeaderView>
 #include <QStandardItemModel>
 
@@ -12,11 +14,20 @@ MessageWindow::MessageWindow(QWidget *parent) : QTableWidget(parent)
     connect(this, &MessageWindow::itemActivated,
         this, &MessageWindow::handleItemActivated);
 
+    // changes are applied in batches, shortly after they were reported
     mUpdateItemsTimer = new QTimer(this);
     connect(mUpdateItemsTimer, &QTimer::timeout,
         this, &MessageWindow::updateMessages);
     mUpdateItemsTimer->setSingleShot(true);
-    mUpdateItemsTimer->start();
+    mUpdateItemsTimer->setInterval(50);
+    // the handler is also called from other threads, so the timer is only
+    // accessed on the main thread, where it may have been deleted meanwhile
+    MessageList::setChangeHandler([timer = QPointer<QTimer>(mUpdateItemsTimer)]() {
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [timer]() {
+            if (timer && !timer->isActive())
+                timer->start();
+        }, Qt::QueuedConnection);
+    });
 
     setColumnCount(2);
     verticalHeader()->setVisible(false);
@@ -36,25 +47,33 @@ MessageWindow::MessageWindow(QWidget *parent) : QTableWidget(parent)
     mInfoIcon.addFile(QStringLiteral(":/images/16x16/dialog-information.png"));
     mWarningIcon.addFile(QStringLiteral(":/images/16x16/dialog-warning.png"));
     mErrorIcon.addFile(QStringLiteral(":/images/16x16/dialog-error.png"));
+
+    for (const auto &message : MessageList::messages())
+        addMessageOnce(*message);
+}
+
+MessageWindow::~MessageWindow()
+{
+    MessageList::setChangeHandler({ });
 }
 
 void MessageWindow::updateMessages()
 {
+    auto addedMessages = QList<MessagePtr>();
+    auto removedMessageIds = QList<MessageId>();
+    MessageList::takeChanges(&addedMessages, &removedMessageIds);
+
+    setUpdatesEnabled(false);
+    for (auto messageId : qAsConst(removedMessageIds))
+        removeMessage(messageId);
+
     auto added = false;
-    auto messages = MessageList::messages();
-    auto messageIds = QSet<MessageId>();
-    for (auto it = messages.begin(); it != messages.end(); ) {
-        const auto& message = **it;
-        added |= addMessageOnce(message);
-        messageIds += message.id;
-        ++it;
-    }
-    removeMessagesExcept(messageIds);
+    for (const auto &message : qAsConst(addedMessages))
+        added |= addMessageOnce(*message);
+    setUpdatesEnabled(true);
 
     if (added)
         Q_EMIT messagesAdded();
-
-    mUpdateItemsTimer->start(50);
 }
 
 QIcon MessageWindow::getMessageIcon(const Message &message) const
@@ -178,16 +197,13 @@ QString MessageWindow::getLocationText(const Message &message) const
     return locationText;
 }
 
-void MessageWindow::removeMessagesExcept(const QSet<MessageId> &messageIds)
+void MessageWindow::removeMessage(MessageId messageId)
 {
-    for (auto row = 0; row < mMessageIds.size(); )
-        if (!messageIds.contains(mMessageIds[row])) {
-            removeRow(row);
-            mMessageIds.removeAt(row);
-        }
-        else {
-            ++row;
-        }
+    auto it = std::lower_bound(mMessageIds.begin(), mMessageIds.end(), messageId);
+    if (it == mMessageIds.end() || *it != messageId)
+        return;
+    removeRow(static_cast<int>(std::distance(mMessageIds.begin(), it)));
+    mMessageIds.erase(it);
 }
 
 bool MessageWindow::addMessageOnce(const Message &message)
@@ -13,6 +13,7 @@ class MessageWindow final : public QTableWidget
 
 public:
     explicit MessageWindow(QWidget *parent = nullptr);
+    ~MessageWindow() override;
 
 Q_SIGNALS:
     void messageActivated(int itemId, QString fileName, int line, int column);
@@ -24,7 +25,7 @@ private:
     QIcon getMessageIcon(const Message &message) const;
     QString getMessageText(const Message &message) const;
     QString getLocationText(const Message &message) const;
-    void removeMessagesExcept(const QSet<MessageId> &messageIds);
+    void removeMessage(MessageId messageId);
     bool addMessageOnce(const Message &message);
 
     QTimer *mUpdateItemsTimer;
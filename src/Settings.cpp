@@ -12,6 +12,8 @@ Settings::Settings(QObject *parent) : QSettings(parent)
     setIndentWithSpaces(value("indentWithSpaces", "true").toBool());
     setShowWhiteSpace(value("showWhiteSpace", "false").toBool());
     setDarkTheme(value("darkTheme", "false").toBool());
+    setTrackMemoryBarriers(value("trackMemoryBarriers", "true").toBool());
+    setFileCacheBudget(value("fileCacheBudget", "1024").toInt());
 
     auto fontSettings = value("font").toString();
     if (!fontSettings.isEmpty()) {
@@ -28,6 +30,8 @@ Settings::~Settings()
     setValue("indentWithSpaces", indentWithSpaces());
     setValue("showWhiteSpace", showWhiteSpace());
     setValue("darkTheme", darkTheme());
+    setValue("trackMemoryBarriers", trackMemoryBarriers());
+    setValue("fileCacheBudget", fileCacheBudget());
     setValue("font", font().toString());
     endGroup();
 }
@@ -81,3 +85,15 @@ void Settings::setDarkTheme(bool enabled)
     Q_EMIT darkThemeChanging(enabled);
     Q_EMIT darkThemeChanged(enabled);
 }
+
+void Settings::setTrackMemoryBarriers(bool enabled)
+{
+    mTrackMemoryBarriers = enabled;
+    Q_EMIT trackMemoryBarriersChanged(enabled);
+}
+
+void Settings::setFileCacheBudget(int megabytes)
+{
+    mFileCacheBudget = megabytes;
+    Q_EMIT fileCacheBudgetChanged(megabytes);
+}
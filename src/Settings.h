@@ -24,6 +24,10 @@ public:
     bool showWhiteSpace() const { return mShowWhiteSpace; }
     void setDarkTheme(bool enabled);
     bool darkTheme() const { return mDarkTheme; }
+    void setTrackMemoryBarriers(bool enabled);
+    bool trackMemoryBarriers() const { return mTrackMemoryBarriers; }
+    void setFileCacheBudget(int megabytes);
+    int fileCacheBudget() const { return mFileCacheBudget; }
 
 Q_SIGNALS:
     void tabSizeChanged(int tabSize);
@@ -33,6 +37,8 @@ Q_SIGNALS:
     void showWhiteSpaceChanged(bool enabled);
     void darkThemeChanging(bool enabled);
     void darkThemeChanged(bool enabled);
+    void trackMemoryBarriersChanged(bool enabled);
+    void fileCacheBudgetChanged(int megabytes);
 
 private:
     int mTabSize{ 2 };
@@ -41,6 +47,8 @@ private:
     bool mIndentWithSpaces{ true };
     bool mShowWhiteSpace{ };
     bool mDarkTheme{ };
+    bool mTrackMemoryBarriers{ true };
+    int mFileCacheBudget{ 1024 };
 };
 
 #endif // SETTINGS_H
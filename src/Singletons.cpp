@@ -40,6 +40,7 @@ FileCache &Singletons::fileCache()
 FileDialog &Singletons::fileDialog()
 {
     Q_ASSERT(onMainThread());
+    Q_ASSERT(!headless());
     return *sInstance->mFileDialog;
 }
 
@@ -72,21 +73,37 @@ VideoManager &Singletons::videoManager()
     return *sInstance->mVideoManager;
 }
 
+bool Singletons::headless()
+{
+    return !sInstance->mEditorManager;
+}
+
 Singletons::Singletons(QMainWindow *window)
     : mSettings(new Settings())
     , mFileCache(new FileCache())
-    , mFileDialog(new FileDialog(window))
-    , mEditorManager(new EditorManager())
     , mSessionModel(new SessionModel())
     , mGLShareSynchronizer(new GLShareSynchronizer())
     , mVideoManager(new VideoManager())
 {
     Q_ASSERT(onMainThread());
     sInstance = this;
-    mSynchronizeLogic.reset(new SynchronizeLogic());
+
+    // widgets are only created when there is a window
+    if (window) {
+        mFileDialog.reset(new FileDialog(window));
+        mEditorManager.reset(new EditorManager());
+        mSynchronizeLogic.reset(new SynchronizeLogic());
+    }
 
     QObject::connect(&fileCache(), &FileCache::videoPlayerRequested,
         &videoManager(), &VideoManager::handleVideoPlayerRequested, Qt::QueuedConnection);
+
+    const auto setFileCacheBudget = [](int megabytes) {
+        fileCache().setMemoryBudget(static_cast<qint64>(megabytes) << 20);
+    };
+    setFileCacheBudget(settings().fileCacheBudget());
+    QObject::connect(&settings(), &Settings::fileCacheBudgetChanged,
+        setFileCacheBudget);
 }
 
 Singletons::~Singletons() = default;
@@ -28,7 +28,10 @@ public:
     static SynchronizeLogic &synchronizeLogic();
     static GLShareSynchronizer &glShareSynchronizer();
     static VideoManager &videoManager();
+    static bool headless();
 
+    // a headless instance is created without a window,
+    // there are no editors and no synchronize logic
     explicit Singletons(QMainWindow *window);
     ~Singletons();
 
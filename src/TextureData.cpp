@@ -6,6 +6,9 @@
 #include <QOpenGLContext>
 #include <QOpenGLFunctions_3_3_Core>
 #include <QScopeGuard>
+#include <QFile>
+#include <QFileInfo>
+#include <limits>
 
 #if defined(_WIN32)
 
@@ -238,19 +241,71 @@ namespace {
         return { };
     }
 
-    void flipImageVertically(uchar * data, int pitch, int height)
+    bool hasPrefix(const QByteArray &header, const uchar *prefix, int size)
     {
-        auto buffer = std::vector<std::byte>(pitch);
-        auto low = data;
-        auto high = &data[(height - 1) * pitch];
-        for (; low < high; low += pitch, high -= pitch) {
-            std::memcpy(buffer.data(), low, pitch);
-            std::memcpy(low, high, pitch);
-            std::memcpy(high, buffer.data(), pitch);
+        return (header.size() >= size &&
+                std::memcmp(header.constData(), prefix, static_cast<size_t>(size)) == 0);
+    }
+
+    bool isKtx(const QByteArray &header, const QString &)
+    {
+        const uchar identifier[] = KTX_IDENTIFIER_REF;
+        return hasPrefix(header, identifier, sizeof(identifier));
+    }
+
+    bool isGli(const QByteArray &header, const QString &fileName)
+    {
+        const uchar dds[] = { 'D', 'D', 'S', ' ' };
+        const uchar kmg[] = { 0xAB, 0x4B, 0x49, 0x4D, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+        return (hasPrefix(header, dds, sizeof(dds)) ||
+                hasPrefix(header, kmg, sizeof(kmg)) ||
+                isKtx(header, fileName));
+    }
+
+    bool isTga(const QByteArray &, const QString &fileName)
+    {
+        // TGA has no magic number
+        return fileName.endsWith(".tga", Qt::CaseInsensitive);
+    }
+
+    bool isAny(const QByteArray &, const QString &)
+    {
+        // QImage detects format by content
+        return true;
+    }
+
+    class MemoryFileInterface final : public tga::FileInterface
+    {
+    public:
+        explicit MemoryFileInterface(const QByteArray &data) : mData(data) { }
+
+        bool ok() const override { return mOk; }
+        size_t tell() override { return mPosition; }
+        void seek(size_t absPos) override { mPosition = absPos; }
+        void write8(uint8_t) override { mOk = false; }
+
+        uint8_t read8() override
+        {
+            if (mPosition < static_cast<size_t>(mData.size()))
+                return static_cast<uint8_t>(mData.constData()[mPosition++]);
+            mOk = false;
+            return 0;
         }
-      }
+
+    private:
+        const QByteArray &mData;
+        size_t mPosition{ };
+        bool mOk{ true };
+    };
 } // namespace
 
+const TextureData::FileFormat TextureData::sFileFormats[] = {
+    { isKtx, &TextureData::loadKtx },
+    { isGli, &TextureData::loadGli },
+    { isTga, &TextureData::loadTga },
+    { isAny, &TextureData::loadQImage },
+};
+
 TextureDataType getTextureDataType(
     const QOpenGLTexture::TextureFormat &format)
 {
@@ -553,10 +608,12 @@ bool TextureData::create(
     return false;
 }
 
-bool TextureData::loadKtx(const QString &fileName, bool flipVertically)
+bool TextureData::loadKtx(const QByteArray &data, const QString &)
 {
     auto texture = std::add_pointer_t<ktxTexture>{ };
-    if (ktxTexture_CreateFromNamedFile(fileName.toUtf8().constData(),
+    if (ktxTexture_CreateFromMemory(
+            reinterpret_cast<const ktx_uint8_t*>(data.constData()),
+            static_cast<ktx_size_t>(data.size()),
             KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &texture) != KTX_SUCCESS)
         return false;
 
@@ -566,15 +623,12 @@ bool TextureData::loadKtx(const QString &fileName, bool flipVertically)
     return true;
 }
 
-bool TextureData::loadGli(const QString &fileName, bool flipVertically) try
+bool TextureData::loadGli(const QByteArray &data, const QString &) try
 {
-    auto texture = gli::load(fileName.toUtf8().constData());
+    auto texture = gli::load(data.constData(), static_cast<std::size_t>(data.size()));
     if (texture.empty())
         return false;
 
-    if (flipVertically)
-        texture = gli::flip(std::move(texture));
-
     auto gl = gli::gl(gli::gl::PROFILE_GL33);
     const auto format = gl.translate(texture.format(), texture.swizzles());
     const auto target = static_cast<QOpenGLTexture::Target>(gl.translate(texture.target()));
@@ -598,7 +652,7 @@ bool TextureData::loadGli(const QString &fileName, bool flipVertically) try
 
                 std::memcpy(dest, source, std::min(sourceSize, destSize));
             }
-    mFlippedVertically = flipVertically;
+    mFlippedVertically = false;
     return true;
 }
 catch (...)
@@ -606,17 +660,18 @@ catch (...)
     return false;
 }
 
-bool TextureData::loadQImage(const QString &fileName, bool flipVertically)
+bool TextureData::loadQImage(const QByteArray &data, const QString &fileName)
 {
+    // suffix is a hint for formats which cannot be detected by content
     auto image = QImage();
-    if (!image.load(fileName))
+    const auto suffix = QFileInfo(fileName).suffix().toLatin1();
+    const auto loaded = (!suffix.isEmpty() &&
+        image.loadFromData(data, suffix.constData()));
+    if (!loaded && !image.loadFromData(data))
         return false;
 
     image = std::move(image).convertToFormat(getNextNativeImageFormat(image.format()));
 
-    if (flipVertically)
-        image = std::move(image).mirrored();
-
     if (!create(QOpenGLTexture::Target2D, getTextureFormat(image.format()),
                 image.width(), image.height()))
         return false;
@@ -627,18 +682,13 @@ bool TextureData::loadQImage(const QString &fileName, bool flipVertically)
     std::memcpy(getWriteonlyData(0, 0, 0), image.constBits(),
         static_cast<size_t>(getImageSize(0)));
 
-    mFlippedVertically = flipVertically;
+    mFlippedVertically = false;
     return true;
 }
 
-bool TextureData::loadTga(const QString &fileName, bool flipVertically)
+bool TextureData::loadTga(const QByteArray &data, const QString &)
 {
-    auto f = std::fopen(fileName.toUtf8().constData(), "rb");
-    if (!f)
-        return false;
-    auto guard = qScopeGuard([&]() { std::fclose(f); });
-
-    auto file = tga::StdioFileInterface(f);
+    auto file = MemoryFileInterface(data);
     auto decoder = tga::Decoder(&file);
     auto header = tga::Header();
     if (!decoder.readHeader(header))
@@ -660,20 +710,60 @@ bool TextureData::loadTga(const QString &fileName, bool flipVertically)
     if (!decoder.readImage(header, image, nullptr))
         return false;
 
-    if (flipVertically)
-        flipImageVertically(image.pixels, image.rowstride, header.height);
-
     decoder.postProcessImage(header, image);
-    mFlippedVertically = flipVertically;
+    mFlippedVertically = false;
     return true;
 }
 
-bool TextureData::load(const QString &fileName, bool flipVertically)
+bool TextureData::load(const QString &fileName)
+{
+    // file is read once and passed to the decoders matching its header
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+
+    auto data = QByteArray();
+    const auto size = file.size();
+    if (size > 0 && size <= std::numeric_limits<int>::max())
+        if (const auto mapped = file.map(0, size))
+            data = QByteArray::fromRawData(
+                reinterpret_cast<const char*>(mapped), static_cast<int>(size));
+    if (data.isNull())
+        data = file.readAll();
+
+    for (const auto &format : sFileFormats)
+        if (format.matches(data, fileName) &&
+            (this->*format.load)(data, fileName))
+            return true;
+    return false;
+}
+
+bool TextureData::flipVertically()
 {
-    return loadKtx(fileName, flipVertically) ||
-           loadGli(fileName, flipVertically) ||
-           loadTga(fileName, flipVertically) ||
-           loadQImage(fileName, flipVertically);
+    if (isNull() || isCompressed())
+        return false;
+
+    // rows of each depth slice are copied in reverse order to new storage
+    const auto source = *this;
+    for (auto level = 0; level < levels(); ++level) {
+        const auto height = getLevelHeight(level);
+        const auto slices = getLevelDepth(level);
+        const auto pitch = getImageSize(level) / (height * slices);
+        for (auto layer = 0; layer < layers(); ++layer)
+            for (auto face = 0; face < faces(); ++face) {
+                const auto src = source.getData(level, layer, face);
+                const auto dest = getWriteonlyData(level, layer, face);
+                if (!src || !dest)
+                    return false;
+                for (auto slice = 0; slice < slices; ++slice)
+                    for (auto y = 0; y < height; ++y)
+                        std::memcpy(dest + (slice * height + y) * pitch,
+                            src + (slice * height + height - 1 - y) * pitch,
+                            static_cast<size_t>(pitch));
+            }
+    }
+    mFlippedVertically = !mFlippedVertically;
+    return true;
 }
 
 bool TextureData::saveKtx(const QString &fileName, bool flipVertically) const
@@ -944,6 +1034,11 @@ int TextureData::getLevelSize(int level) const
     return getImageSize(level) * layers() * faces();
 }
 
+qint64 TextureData::getDataSize() const
+{
+    return (isNull() ? 0 : static_cast<qint64>(mKtxTexture->dataSize));
+}
+
 void TextureData::clear()
 {
     if (isNull())
@@ -1011,6 +1106,120 @@ bool TextureData::upload(GLuint *textureId,
     return result;
 }
 
+bool TextureData::uploadModified(GLuint textureId,
+    const TextureData &uploaded, QOpenGLTexture::TextureFormat format)
+{
+    if (isNull() || !textureId || uploaded.isNull())
+        return false;
+    if (!format)
+        format = this->format();
+
+    // only possible when storage of texture can be kept
+    if (isMultisample() || isCompressed() ||
+        target() != uploaded.target() ||
+        this->format() != uploaded.format() ||
+        pixelFormat() != uploaded.pixelFormat() ||
+        pixelType() != uploaded.pixelType() ||
+        width() != uploaded.width() ||
+        height() != uploaded.height() ||
+        depth() != uploaded.depth() ||
+        levels() != uploaded.levels() ||
+        layers() != uploaded.layers() ||
+        faces() != uploaded.faces())
+        return false;
+
+    auto pixelFormat = static_cast<GLenum>(this->pixelFormat());
+    if (format != this->format()) {
+        auto tmp = TextureData();
+        tmp.create(QOpenGLTexture::Target::Target2D, format, 1, 1);
+        pixelFormat = tmp.mKtxTexture->glFormat;
+    }
+    const auto pixelType = static_cast<GLenum>(this->pixelType());
+
+    Q_ASSERT(glGetError() == GL_NO_ERROR);
+    QOpenGLFunctions_3_3_Core gl;
+    gl.initializeOpenGLFunctions();
+    gl.glBindTexture(mTarget, textureId);
+    auto prevAlignment = GLint{ };
+    gl.glGetIntegerv(GL_UNPACK_ALIGNMENT, &prevAlignment);
+
+    // levels are regenerated when level 0 was modified
+    const auto generateMipmaps = (mKtxTexture->generateMipmaps == KTX_TRUE);
+    auto level0Modified = false;
+    for (auto level = 0; level < (generateMipmaps ? 1 : levels()); ++level) {
+        const auto width = getLevelWidth(level);
+        const auto height = getLevelHeight(level);
+        const auto depth = getLevelDepth(level);
+        const auto imageSize = getImageSize(level);
+        const auto rowPitch = imageSize / std::max(height * depth, 1);
+        gl.glPixelStorei(GL_UNPACK_ALIGNMENT, rowPitch % 4 ? 1 : 4);
+
+        for (auto layer = 0; layer < layers(); ++layer)
+            for (auto face = 0; face < faces(); ++face) {
+                const auto data = getData(level, layer, face);
+                const auto prev = uploaded.getData(level, layer, face);
+                if (data == prev || !std::memcmp(data, prev, imageSize))
+                    continue;
+                if (level == 0)
+                    level0Modified = true;
+
+                // restrict to modified rows, except for 3D textures
+                auto begin = 0;
+                auto end = height;
+                if (mTarget != QOpenGLTexture::Target3D) {
+                    while (!std::memcmp(data + begin * rowPitch,
+                            prev + begin * rowPitch, rowPitch))
+                        ++begin;
+                    while (!std::memcmp(data + (end - 1) * rowPitch,
+                            prev + (end - 1) * rowPitch, rowPitch))
+                        --end;
+                }
+                const auto rows = data + begin * rowPitch;
+
+                switch (mTarget) {
+                    case QOpenGLTexture::Target1D:
+                        gl.glTexSubImage1D(mTarget, level, 0, width,
+                            pixelFormat, pixelType, rows);
+                        break;
+                    case QOpenGLTexture::Target1DArray:
+                        gl.glTexSubImage2D(mTarget, level, 0, layer, width, 1,
+                            pixelFormat, pixelType, rows);
+                        break;
+                    case QOpenGLTexture::Target2D:
+                    case QOpenGLTexture::TargetRectangle:
+                        gl.glTexSubImage2D(mTarget, level, 0, begin,
+                            width, end - begin, pixelFormat, pixelType, rows);
+                        break;
+                    case QOpenGLTexture::TargetCubeMap:
+                        gl.glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+                            level, 0, begin, width, end - begin,
+                            pixelFormat, pixelType, rows);
+                        break;
+                    case QOpenGLTexture::Target2DArray:
+                        gl.glTexSubImage3D(mTarget, level, 0, begin, layer,
+                            width, end - begin, 1, pixelFormat, pixelType, rows);
+                        break;
+                    case QOpenGLTexture::TargetCubeMapArray:
+                        gl.glTexSubImage3D(mTarget, level, 0, begin, layer * 6 + face,
+                            width, end - begin, 1, pixelFormat, pixelType, rows);
+                        break;
+                    case QOpenGLTexture::Target3D:
+                        gl.glTexSubImage3D(mTarget, level, 0, 0, 0,
+                            width, height, depth, pixelFormat, pixelType, data);
+                        break;
+                    default:
+                        break;
+                }
+            }
+    }
+    gl.glPixelStorei(GL_UNPACK_ALIGNMENT, prevAlignment);
+
+    if (generateMipmaps && level0Modified && levels() > 1)
+        gl.glGenerateMipmap(mTarget);
+
+    return (glGetError() == GL_NO_ERROR);
+}
+
 bool TextureData::download(GLuint textureId)
 {
     if (isNull() || !textureId)
@@ -16,7 +16,7 @@ public:
         int width, int height, 
         int depth = 1, int layers = 1, int samples = 1,
         int levels = 0);
-    bool load(const QString &fileName, bool flipVertically);
+    bool load(const QString &fileName);
     bool save(const QString &fileName, bool flipVertically) const;
     bool isNull() const;
     void clear();
@@ -42,15 +42,21 @@ public:
     int faces() const;
     int samples() const { return mSamples; }
     bool flippedVertically() const { return mFlippedVertically; }
+    void setFlippedVertically(bool flipped) { mFlippedVertically = flipped; }
+    bool flipVertically();
     uchar *getWriteonlyData(int level, int layer, int faceSlice);
     const uchar *getData(int level, int layer, int faceSlice) const;
     int getImageSize(int level) const;
     int getLevelSize(int level) const;
+    qint64 getDataSize() const;
     void setPixelFormat(QOpenGLTexture::PixelFormat pixelFormat);
     bool upload(GLuint textureId, QOpenGLTexture::TextureFormat format =
         QOpenGLTexture::TextureFormat::NoFormat);
     bool upload(GLuint *textureId, QOpenGLTexture::TextureFormat format =
         QOpenGLTexture::TextureFormat::NoFormat);
+    bool uploadModified(GLuint textureId, const TextureData &uploaded,
+        QOpenGLTexture::TextureFormat format =
+        QOpenGLTexture::TextureFormat::NoFormat);
     bool download(GLuint textureId);
 
     friend bool operator==(const TextureData &a, const TextureData &b);
@@ -59,10 +65,18 @@ public:
 private:
     using GL = QOpenGLFunctions_3_3_Core;
 
-    bool loadKtx(const QString &fileName, bool flipVertically);
-    bool loadGli(const QString &fileName, bool flipVertically);
-    bool loadQImage(const QString &fileName, bool flipVertically);
-    bool loadTga(const QString &fileName, bool flipVertically);
+    // decoders are tried in order, when they match the file header
+    struct FileFormat
+    {
+        bool (*matches)(const QByteArray &header, const QString &fileName);
+        bool (TextureData::*load)(const QByteArray &data, const QString &fileName);
+    };
+    static const FileFormat sFileFormats[];
+
+    bool loadKtx(const QByteArray &data, const QString &fileName);
+    bool loadGli(const QByteArray &data, const QString &fileName);
+    bool loadQImage(const QByteArray &data, const QString &fileName);
+    bool loadTga(const QByteArray &data, const QString &fileName);
     bool saveGli(const QString &fileName, bool flipVertically) const;
     bool saveKtx(const QString &fileName, bool flipVertically) const;
     bool saveQImage(const QString &fileName, bool flipVertically) const;
@@ -11,10 +11,10 @@ VideoManager::VideoManager(QObject *parent)
 
 VideoManager::~VideoManager() = default;
 
-void VideoManager::handleVideoPlayerRequested(const QString &fileName, bool flipVertically)
+void VideoManager::handleVideoPlayerRequested(const QString &fileName)
 {
     Q_ASSERT(onMainThread());
-    auto videoPlayer = new VideoPlayer(fileName, flipVertically);
+    auto videoPlayer = new VideoPlayer(fileName);
     connect(videoPlayer, &VideoPlayer::loadingFinished,
         this, &VideoManager::handleVideoPlayerLoaded);
 }
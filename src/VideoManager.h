@@ -19,7 +19,7 @@ public:
     void pauseVideoFiles();
     void rewindVideoFiles();
 
-    void handleVideoPlayerRequested(const QString &fileName, bool flipVertically);
+    void handleVideoPlayerRequested(const QString &fileName);
 
 private:    
     void handleVideoPlayerLoaded();
@@ -7,10 +7,9 @@
 #include <QMediaPlaylist>
 #include <cstring>
 
-VideoPlayer::VideoPlayer(QString fileName, bool flipVertically, QObject *parent)
+VideoPlayer::VideoPlayer(QString fileName, QObject *parent)
     : QAbstractVideoSurface(parent)
     , mFileName(fileName)
-    , mFlipVertically(flipVertically)
 {
     mPlayer = new QMediaPlayer(this);
     connect(mPlayer, &QMediaPlayer::mediaStatusChanged,
@@ -69,7 +68,7 @@ bool VideoPlayer::present(const QVideoFrame &frame)
                 std::memcpy(texture.getWriteonlyData(0, 0, 0), data, std::min(size, texture.getImageSize(0)));
                 buffer->unmap();
                 return Singletons::fileCache().updateTexture(
-                    mFileName, mFlipVertically, std::move(texture));
+                    mFileName, std::move(texture));
             }
         }
     }
@@ -10,7 +10,7 @@ class VideoPlayer final : public QAbstractVideoSurface
 {
     Q_OBJECT
 public:
-    VideoPlayer(QString fileName, bool flipVertically, QObject *parent = nullptr);
+    explicit VideoPlayer(QString fileName, QObject *parent = nullptr);
 
     QList<QVideoFrame::PixelFormat> supportedPixelFormats(
         QAbstractVideoBuffer::HandleType) const override;
@@ -33,7 +33,6 @@ private:
     QString mFileName;
     int mWidth{ };
     int mHeight{ };
-    bool mFlipVertically{ };
 };
 
 #else // !Qt5Multimedia_FOUND
@@ -44,7 +43,7 @@ class VideoPlayer final : public QObject
 {
     Q_OBJECT
 public:
-    explicit VideoPlayer(QString fileName, bool flipVertically, QObject *parent = nullptr)
+    explicit VideoPlayer(QString fileName, QObject *parent = nullptr)
         : QObject(parent), mFileName(fileName) { }
     const QString &fileName() const { return mFileName; }
     int width() const { return 0; }
@@ -10,6 +10,7 @@
 #include <QSaveFile>
 #include <cstdint>
 #include <cstring>
+#include <limits>
 
 namespace
 {
@@ -148,6 +149,34 @@ void BinaryEditor::replace(QByteArray data, bool emitFileChanged)
         return;
 
     mData = data;
+    mModifiedRange = { 0, std::numeric_limits<int>::max() };
+    handleReplaced(emitFileChanged);
+}
+
+void BinaryEditor::replaceRange(int offset, QByteArray data, bool emitFileChanged)
+{
+    if (offset == 0 && data.size() >= mData.size()) {
+        replace(data, emitFileChanged);
+        return;
+    }
+
+    if (offset + data.size() > mData.size())
+        mData.resize(offset + data.size());
+    std::memcpy(mData.data() + offset, data.constData(), data.size());
+
+    const auto end = offset + static_cast<int>(data.size());
+    if (mModifiedRange.first < mModifiedRange.second) {
+        mModifiedRange.first = std::min(mModifiedRange.first, offset);
+        mModifiedRange.second = std::max(mModifiedRange.second, end);
+    }
+    else {
+        mModifiedRange = { offset, end };
+    }
+    handleReplaced(emitFileChanged);
+}
+
+void BinaryEditor::handleReplaced(bool emitFileChanged)
+{
     refresh();
 
     if (!FileDialog::isEmptyOrUntitled(mFileName))
@@ -156,21 +185,14 @@ void BinaryEditor::replace(QByteArray data, bool emitFileChanged)
     Singletons::fileCache().handleEditorFileChanged(mFileName, emitFileChanged);
 }
 
-void BinaryEditor::replaceRange(int offset, QByteArray data, bool emitFileChanged)
+std::pair<int, int> BinaryEditor::takeModifiedRange()
 {
-    if (offset == 0 && data.size() >= mData.size()) {
-        mData = data;
-    }
-    else {
-        if (offset + data.size() > mData.size())
-            mData.resize(offset + data.size());
-        std::memcpy(mData.data() + offset, data.constData(), data.size());
-    }
-    replace(std::exchange(mData, { }), emitFileChanged);
+    return std::exchange(mModifiedRange, { });
 }
 
 void BinaryEditor::handleDataChanged()
 {
+    mModifiedRange = { 0, std::numeric_limits<int>::max() };
     setModified(true);
     Singletons::fileCache().handleEditorFileChanged(mFileName);
 }
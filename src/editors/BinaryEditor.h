@@ -3,6 +3,7 @@
 
 #include "IEditor.h"
 #include <QTableView>
+#include <utility>
 
 class BinaryEditorToolBar;
 
@@ -52,6 +53,7 @@ public:
     void replace(QByteArray data, bool emitFileChanged = true);
     void replaceRange(int offset, QByteArray data, bool emitFileChanged = true);
     const QByteArray &data() const { return mData; }
+    std::pair<int, int> takeModifiedRange();
     void setBlocks(QList<Block> blocks);
     void setCurrentBlockIndex(int index);
     void scrollToOffset();
@@ -71,6 +73,7 @@ private:
     class HexModel;
 
     void handleDataChanged();
+    void handleReplaced(bool emitFileChanged);
     void setModified(bool modified);
     const Block *currentBlock() const;
     void refresh();
@@ -80,6 +83,7 @@ private:
     QString mFileName;
     bool mModified{ };
     QByteArray mData;
+    std::pair<int, int> mModifiedRange;
     EditableRegion *mEditableRegion{ };
     int mRowHeight{ 20 };
     int mColumnWidth{ 32 };
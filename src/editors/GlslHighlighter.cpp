@@ -1,6 +1,9 @@
 #include "GlslHighlighter.h"
 #include <QCompleter>
 #include <QStringListModel>
+#include <QHash>
+#include <algorithm>
+#include <cctype>
 
 namespace {
 const auto keywords = {
@@ -135,103 +138,195 @@ const auto layoutQualifiers = {
     "r8_snorm", "rgba32i", "rgba16i", "rgba8i", "rg32i", "rg16i", "rg8i",
     "r32i", "r16i", "r8i", "rgba32ui", "rgba16ui", "rgb10_a2ui", "rgba8ui",
     "rg32ui", "rg16ui", "rg8ui", "r32ui", "r16ui", "r8ui" };
-} // namespace
 
-GlslHighlighter::GlslHighlighter(bool darkTheme, QObject *parent)
-    : QSyntaxHighlighter(parent)
+class GlslLexer final : public SyntaxHighlighter::Lexer
+{
+public:
+    explicit GlslLexer(bool darkTheme);
+    int highlightBlock(const QString &text, int previousState,
+        SyntaxHighlighter::FormatRanges &formats) const override;
+
+private:
+    QHash<QString, QTextCharFormat> mWordFormats;
+    QTextCharFormat mFunctionFormat;
+    QTextCharFormat mNumberFormat;
+    QTextCharFormat mQuotationFormat;
+    QTextCharFormat mPreprocessorFormat;
+    QTextCharFormat mCommentFormat;
+    QTextCharFormat mWhiteSpaceFormat;
+};
+
+GlslLexer::GlslLexer(bool darkTheme)
 {
     QTextCharFormat keywordFormat;
     QTextCharFormat builtinFunctionFormat;
     QTextCharFormat builtinConstantsFormat;
-    QTextCharFormat preprocessorFormat;
-    QTextCharFormat quotationFormat;
-    QTextCharFormat numberFormat;
-    QTextCharFormat functionFormat;
-    QTextCharFormat whiteSpaceFormat;
 
-    functionFormat.setFontWeight(QFont::Bold);
+    mFunctionFormat.setFontWeight(QFont::Bold);
 
     if (darkTheme) {
-        functionFormat.setForeground(QColor(0x7AAFFF));
+        mFunctionFormat.setForeground(QColor(0x7AAFFF));
         keywordFormat.setForeground(QColor(0x7AAFFF));
         builtinFunctionFormat.setForeground(QColor(0x7AAFFF));
         builtinConstantsFormat.setForeground(QColor(0xDD8D8D));
-        numberFormat.setForeground(QColor(0xB09D30));
-        quotationFormat.setForeground(QColor(0xB09D30));
-        preprocessorFormat.setForeground(QColor(0xC87FFF));
+        mNumberFormat.setForeground(QColor(0xB09D30));
+        mQuotationFormat.setForeground(QColor(0xB09D30));
+        mPreprocessorFormat.setForeground(QColor(0xC87FFF));
         mCommentFormat.setForeground(QColor(0x56C056));
-        whiteSpaceFormat.setForeground(QColor(0x666666));
+        mWhiteSpaceFormat.setForeground(QColor(0x666666));
     }
     else {
-        functionFormat.setForeground(QColor(0x000066));        
+        mFunctionFormat.setForeground(QColor(0x000066));
         keywordFormat.setForeground(QColor(0x003C98));
         builtinFunctionFormat.setForeground(QColor(0x000066));
         builtinConstantsFormat.setForeground(QColor(0x981111));
-        numberFormat.setForeground(QColor(0x981111));
-        quotationFormat.setForeground(QColor(0x981111));
-        preprocessorFormat.setForeground(QColor(0x800080));
+        mNumberFormat.setForeground(QColor(0x981111));
+        mQuotationFormat.setForeground(QColor(0x981111));
+        mPreprocessorFormat.setForeground(QColor(0x800080));
         mCommentFormat.setForeground(QColor(0x008700));
-        whiteSpaceFormat.setForeground(QColor(0xCCCCCC));
+        mWhiteSpaceFormat.setForeground(QColor(0xCCCCCC));
     }
 
-    auto rule = HighlightingRule();
-    auto completerStrings = QStringList();
+    // the first list containing a word determines its format
+    const auto addWords = [&](const auto &words, const QTextCharFormat &format) {
+        for (const auto &word : words)
+            if (!mWordFormats.contains(word))
+                mWordFormats.insert(word, format);
+    };
+    addWords(keywords, keywordFormat);
+    addWords(builtinFunctions, builtinFunctionFormat);
+    addWords(builtinConstants, builtinConstantsFormat);
+}
 
-    for (const auto &keyword : keywords) {
-        rule.pattern = QRegularExpression(QStringLiteral("\\b%1\\b").arg(keyword));
-        rule.format = keywordFormat;
-        mHighlightingRules.append(rule);
-        completerStrings.append(keyword);
-    }
+int GlslLexer::highlightBlock(const QString &text, int previousState,
+    SyntaxHighlighter::FormatRanges &formats) const
+{
+    const auto length = static_cast<int>(text.length());
+    const auto at = [&](int index) {
+        return (index < length ? text[index] : QChar());
+    };
+    const auto setFormat = [&](int start, int count,
+            const QTextCharFormat &format) {
+        formats.append({ start, count, format });
+    };
+    const auto isIdentifierStart = [](QChar c) {
+        return (c.isLetter() || c == '_');
+    };
+    const auto isIdentifierPart = [](QChar c) {
+        return (c.isLetterOrNumber() || c == '_');
+    };
 
-    for (const auto &builtinFunction : builtinFunctions) {
-        rule.pattern = QRegularExpression(QStringLiteral("\\b%1\\b").arg(builtinFunction));
-        rule.format = builtinFunctionFormat;
-        mHighlightingRules.append(rule);
-        completerStrings.append(builtinFunction);
-    }
+    auto index = 0;
+    auto lineStart = true;
 
-    for (const auto &builtinConstant : builtinConstants) {
-        rule.pattern = QRegularExpression(QStringLiteral("\\b%1\\b").arg(builtinConstant));
-        rule.format = builtinConstantsFormat;
-        mHighlightingRules.append(rule);
-        completerStrings.append(builtinConstant);
+    // continue multiline comment of previous block
+    if (previousState == 1) {
+        const auto end = text.indexOf(QStringLiteral("*/"));
+        if (end < 0) {
+            setFormat(0, length, mCommentFormat);
+            return 1;
+        }
+        index = end + 2;
+        setFormat(0, index, mCommentFormat);
     }
 
-    for (const auto &qaulifier : layoutQualifiers)
-        completerStrings.append(qaulifier);
-
-    rule.pattern = QRegularExpression("\\b[A-Za-z_][A-Za-z0-9_]*(?=\\s*\\()");
-    rule.format = functionFormat;
-    mHighlightingRules.append(rule);
-
-    rule.pattern = QRegularExpression("\\b[0-9]*\\.?[0-9]+([eE][-+]?[0-9]+)?[uUlLfF]{,2}\\b");
-    rule.format = numberFormat;
-    mHighlightingRules.append(rule);
+    // scan once, classifying each token by its first characters
+    while (index < length) {
+        const auto begin = index;
+        const auto c = text[index];
 
-    rule.pattern = QRegularExpression("\\b0x[0-9,A-F,a-f]+[uUlL]\\b");
-    rule.format = numberFormat;
-    mHighlightingRules.append(rule);
-
-    auto quotation = QString("%1([^%1]*(\\\\%1[^%1]*)*)(%1|$)");
-    rule.pattern = QRegularExpression(quotation.arg('"'));
-    rule.format = quotationFormat;
-    mHighlightingRules.append(rule);
-
-    rule.pattern = QRegularExpression("^\\s*#.*");
-    rule.format = preprocessorFormat;
-    mHighlightingRules.append(rule);
+        if (c.isSpace()) {
+            while (at(index).isSpace())
+                ++index;
+            setFormat(begin, index - begin, mWhiteSpaceFormat);
+            continue;
+        }
 
-    rule.pattern = QRegularExpression("//.*");
-    rule.format = mCommentFormat;
-    mHighlightingRules.append(rule);
+        if (c == '#' && lineStart) {
+            setFormat(begin, length - begin, mPreprocessorFormat);
+            return 0;
+        }
+        else if (c == '/' && at(index + 1) == '/') {
+            setFormat(begin, length - begin, mCommentFormat);
+            return 0;
+        }
+        else if (c == '/' && at(index + 1) == '*') {
+            const auto end = text.indexOf(QStringLiteral("*/"), index + 2);
+            if (end < 0) {
+                setFormat(begin, length - begin, mCommentFormat);
+                return 1;
+            }
+            index = end + 2;
+            setFormat(begin, index - begin, mCommentFormat);
+        }
+        else if (c == '"') {
+            for (++index; index < length && text[index] != '"'; ++index)
+                if (text[index] == '\\')
+                    ++index;
+            index = std::min(index + 1, length);
+            setFormat(begin, index - begin, mQuotationFormat);
+        }
+        else if (c.isDigit() || (c == '.' && at(index + 1).isDigit())) {
+            if (c == '0' && (at(index + 1) == 'x' || at(index + 1) == 'X')) {
+                index += 2;
+                while (std::isxdigit(static_cast<unsigned char>(at(index).toLatin1())))
+                    ++index;
+            }
+            else {
+                while (at(index).isDigit())
+                    ++index;
+                if (at(index) == '.')
+                    ++index;
+                while (at(index).isDigit())
+                    ++index;
+                if ((at(index) == 'e' || at(index) == 'E') &&
+                    (at(index + 1).isDigit() ||
+                     ((at(index + 1) == '-' || at(index + 1) == '+') &&
+                      at(index + 2).isDigit())))
+                    for (index += 2; at(index).isDigit(); )
+                        ++index;
+            }
+            for (auto i = 0; i < 2 && QStringLiteral("uUlLfF").contains(at(index)); ++i)
+                ++index;
+            setFormat(begin, index - begin, mNumberFormat);
+        }
+        else if (isIdentifierStart(c)) {
+            while (isIdentifierPart(at(index)))
+                ++index;
+            const auto it = mWordFormats.find(text.mid(begin, index - begin));
+            if (it != mWordFormats.end()) {
+                setFormat(begin, index - begin, *it);
+            }
+            else {
+                auto next = index;
+                while (at(next).isSpace())
+                    ++next;
+                if (at(next) == '(')
+                    setFormat(begin, index - begin, mFunctionFormat);
+            }
+        }
+        else {
+            ++index;
+        }
+        lineStart = false;
+    }
+    return 0;
+}
 
-    rule.pattern = QRegularExpression("\\s+", QRegularExpression::UseUnicodePropertiesOption);
-    rule.format = whiteSpaceFormat;
-    mHighlightingRules.append(rule);
+} // namespace
 
-    mCommentStartExpression = QRegularExpression("/\\*");
-    mCommentEndExpression = QRegularExpression("\\*/");
+GlslHighlighter::GlslHighlighter(bool darkTheme, QObject *parent)
+    : SyntaxHighlighter(std::make_shared<GlslLexer>(darkTheme), parent)
+{
+    auto completerStrings = QStringList();
+    for (const auto &keyword : keywords)
+        completerStrings.append(keyword);
+    for (const auto &builtinFunction : builtinFunctions)
+        completerStrings.append(builtinFunction);
+    for (const auto &builtinConstant : builtinConstants)
+        completerStrings.append(builtinConstant);
+    for (const auto &qaulifier : layoutQualifiers)
+        completerStrings.append(qaulifier);
 
     mCompleter = new QCompleter(this);
     completerStrings.sort(Qt::CaseInsensitive);
@@ -241,44 +336,3 @@ GlslHighlighter::GlslHighlighter(bool darkTheme, QObject *parent)
     mCompleter->setCaseSensitivity(Qt::CaseInsensitive);
     mCompleter->setWrapAround(false);
 }
-
-void GlslHighlighter::highlightBlock(const QString &text)
-{
-    for (const HighlightingRule &rule : qAsConst(mHighlightingRules)) {
-        auto index = text.indexOf(rule.pattern);
-        while (index >= 0) {
-            const auto match = rule.pattern.match(text, index);
-            const auto length = match.capturedLength();
-            // do not start single line comment in string
-            if (format(index) == QTextCharFormat{ })
-                setFormat(index, length, rule.format);
-            index = text.indexOf(rule.pattern, index + length);
-        }
-    }
-    setCurrentBlockState(0);
-
-    auto startIndex = 0;
-    if (previousBlockState() != 1)
-        startIndex = text.indexOf(mCommentStartExpression);
-
-    while (startIndex >= 0) {
-        // do not start multiline comment in single line comment or string
-        if (startIndex && format(startIndex) != QTextCharFormat{ }) {
-            setCurrentBlockState(0);
-            break;
-        }
-
-        const auto match = mCommentEndExpression.match(text, startIndex);
-        const auto endIndex = match.capturedStart();
-        auto commentLength = 0;
-        if (endIndex == -1) {
-            setCurrentBlockState(1);
-            commentLength = text.length() - startIndex;
-        }
-        else {
-            commentLength = endIndex - startIndex + match.capturedLength();
-        }
-        setFormat(startIndex, commentLength, mCommentFormat);
-        startIndex = text.indexOf(mCommentStartExpression, startIndex + commentLength);
-    }
-}
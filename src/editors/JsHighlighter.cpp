@@ -1,6 +1,9 @@
 #include "JsHighlighter.h"
 #include <QCompleter>
 #include <QStringListModel>
+#include <QSet>
+#include <algorithm>
+#include <cctype>
 
 namespace {
 
@@ -25,92 +28,177 @@ const auto globalObjects = {
     "WeakSet", "ArrayBuffer", "SharedArrayBuffer", "Atomics", "DataView", "JSON",
 
     "true", "false", "console", "print" };
-} // namespace
 
-JsHighlighter::JsHighlighter(bool darkTheme, QObject *parent)
-    : QSyntaxHighlighter(parent)
+class JsLexer final : public SyntaxHighlighter::Lexer
 {
-    QTextCharFormat keywordFormat;
-    QTextCharFormat globalObjectFormat;
-    QTextCharFormat singleLineCommentFormat;
-    QTextCharFormat quotationFormat;
-    QTextCharFormat numberFormat;
-    QTextCharFormat functionFormat;
-    QTextCharFormat whiteSpaceFormat;
-
-    functionFormat.setFontWeight(QFont::Bold);
+public:
+    explicit JsLexer(bool darkTheme);
+    int highlightBlock(const QString &text, int previousState,
+        SyntaxHighlighter::FormatRanges &formats) const override;
+
+private:
+    QSet<QString> mKeywords;
+    QSet<QString> mGlobalObjects;
+    QTextCharFormat mKeywordFormat;
+    QTextCharFormat mGlobalObjectFormat;
+    QTextCharFormat mFunctionFormat;
+    QTextCharFormat mNumberFormat;
+    QTextCharFormat mQuotationFormat;
+    QTextCharFormat mCommentFormat;
+    QTextCharFormat mWhiteSpaceFormat;
+};
+
+JsLexer::JsLexer(bool darkTheme)
+{
+    mFunctionFormat.setFontWeight(QFont::Bold);
 
     if (darkTheme) {
-        functionFormat.setForeground(QColor(0x7AAFFF));
-        keywordFormat.setForeground(QColor(0x7AAFFF));
-        globalObjectFormat.setForeground(QColor(0x7AAFFF));
-        numberFormat.setForeground(QColor(0xB09D30));
-        quotationFormat.setForeground(QColor(0xB09D30));
+        mFunctionFormat.setForeground(QColor(0x7AAFFF));
+        mKeywordFormat.setForeground(QColor(0x7AAFFF));
+        mGlobalObjectFormat.setForeground(QColor(0x7AAFFF));
+        mNumberFormat.setForeground(QColor(0xB09D30));
+        mQuotationFormat.setForeground(QColor(0xB09D30));
         mCommentFormat.setForeground(QColor(0x56C056));
-        whiteSpaceFormat.setForeground(QColor(0x666666));
+        mWhiteSpaceFormat.setForeground(QColor(0x666666));
     }
     else {
-        functionFormat.setForeground(QColor(0x000066));
-        keywordFormat.setForeground(QColor(0x003C98));
-        globalObjectFormat.setForeground(QColor(0x003C98));
-        numberFormat.setForeground(QColor(0x981111));
-        quotationFormat.setForeground(QColor(0x981111));
+        mFunctionFormat.setForeground(QColor(0x000066));
+        mKeywordFormat.setForeground(QColor(0x003C98));
+        mGlobalObjectFormat.setForeground(QColor(0x003C98));
+        mNumberFormat.setForeground(QColor(0x981111));
+        mQuotationFormat.setForeground(QColor(0x981111));
         mCommentFormat.setForeground(QColor(0x008700));
-        whiteSpaceFormat.setForeground(QColor(0xCCCCCC));
+        mWhiteSpaceFormat.setForeground(QColor(0xCCCCCC));
     }
 
-    auto rule = HighlightingRule();
-    auto completerStrings = QStringList();
-
-    for (const auto &keyword : keywords) {
-        rule.pattern = QRegularExpression(QStringLiteral("\\b%1\\b").arg(keyword));
-        rule.format = keywordFormat;
-        mHighlightingRules.append(rule);
-        completerStrings.append(keyword);
-    }
+    for (const auto &keyword : keywords)
+        mKeywords.insert(keyword);
+    for (const auto &global : globalObjects)
+        mGlobalObjects.insert(global);
+}
 
-    for (const auto &global : globalObjects) {
-        rule.pattern = QRegularExpression(QStringLiteral("\\b%1(\\.[A-Za-z0-9]+)*\\b").arg(global));
-        rule.format = globalObjectFormat;
-        mHighlightingRules.append(rule);
-        completerStrings.append(global);
+int JsLexer::highlightBlock(const QString &text, int previousState,
+    SyntaxHighlighter::FormatRanges &formats) const
+{
+    const auto length = static_cast<int>(text.length());
+    const auto at = [&](int index) {
+        return (index < length ? text[index] : QChar());
+    };
+    const auto setFormat = [&](int start, int count,
+            const QTextCharFormat &format) {
+        formats.append({ start, count, format });
+    };
+    const auto isIdentifierStart = [](QChar c) {
+        return (c.isLetter() || c == '_' || c == '$');
+    };
+    const auto isIdentifierPart = [](QChar c) {
+        return (c.isLetterOrNumber() || c == '_' || c == '$');
+    };
+
+    auto index = 0;
+
+    // continue multiline comment of previous block
+    if (previousState == 1) {
+        const auto end = text.indexOf(QStringLiteral("*/"));
+        if (end < 0) {
+            setFormat(0, length, mCommentFormat);
+            return 1;
+        }
+        index = end + 2;
+        setFormat(0, index, mCommentFormat);
     }
 
-    rule.pattern = QRegularExpression("[A-Za-z_$][A-Za-z0-9_$]*(?=\\s*\\()");
-    rule.format = functionFormat;
-    mHighlightingRules.append(rule);
+    // scan once, classifying each token by its first characters
+    while (index < length) {
+        const auto begin = index;
+        const auto c = text[index];
 
-    rule.pattern = QRegularExpression("\\b[0-9]*\\.?[0-9]+([eE][-+]?[0-9]+)?\\b");
-    rule.format = numberFormat;
-    mHighlightingRules.append(rule);
-
-    rule.pattern = QRegularExpression("\\b0x[0-9,A-F,a-f]+\\b");
-    rule.format = numberFormat;
-    mHighlightingRules.append(rule);
-
-    auto quotation = QString("%1([^%1]*(\\\\%1[^%1]*)*)(%1|$)");
-    rule.pattern = QRegularExpression(quotation.arg('"'));
-    rule.format = quotationFormat;
-    mHighlightingRules.append(rule);
-
-    rule.pattern = QRegularExpression(quotation.arg('\''));
-    rule.format = quotationFormat;
-    mHighlightingRules.append(rule);
-
-    rule.pattern = QRegularExpression(quotation.arg('`'));
-    rule.format = quotationFormat;
-    mHighlightingRules.append(rule);
-
-    rule.pattern = QRegularExpression("//.*");
-    rule.format = singleLineCommentFormat;
-    mHighlightingRules.append(rule);
+        if (c.isSpace()) {
+            while (at(index).isSpace())
+                ++index;
+            setFormat(begin, index - begin, mWhiteSpaceFormat);
+        }
+        else if (c == '/' && at(index + 1) == '/') {
+            setFormat(begin, length - begin, mCommentFormat);
+            return 0;
+        }
+        else if (c == '/' && at(index + 1) == '*') {
+            const auto end = text.indexOf(QStringLiteral("*/"), index + 2);
+            if (end < 0) {
+                setFormat(begin, length - begin, mCommentFormat);
+                return 1;
+            }
+            index = end + 2;
+            setFormat(begin, index - begin, mCommentFormat);
+        }
+        else if (c == '"' || c == '\'' || c == '`') {
+            for (++index; index < length && text[index] != c; ++index)
+                if (text[index] == '\\')
+                    ++index;
+            index = std::min(index + 1, length);
+            setFormat(begin, index - begin, mQuotationFormat);
+        }
+        else if (c.isDigit() || (c == '.' && at(index + 1).isDigit())) {
+            if (c == '0' && (at(index + 1) == 'x' || at(index + 1) == 'X')) {
+                index += 2;
+                while (std::isxdigit(static_cast<unsigned char>(at(index).toLatin1())))
+                    ++index;
+            }
+            else {
+                while (at(index).isDigit())
+                    ++index;
+                if (at(index) == '.')
+                    ++index;
+                while (at(index).isDigit())
+                    ++index;
+                if ((at(index) == 'e' || at(index) == 'E') &&
+                    (at(index + 1).isDigit() ||
+                     ((at(index + 1) == '-' || at(index + 1) == '+') &&
+                      at(index + 2).isDigit())))
+                    for (index += 2; at(index).isDigit(); )
+                        ++index;
+            }
+            setFormat(begin, index - begin, mNumberFormat);
+        }
+        else if (isIdentifierStart(c)) {
+            while (isIdentifierPart(at(index)))
+                ++index;
+            const auto word = text.mid(begin, index - begin);
+            if (mKeywords.contains(word)) {
+                setFormat(begin, index - begin, mKeywordFormat);
+            }
+            else if (mGlobalObjects.contains(word)) {
+                // include accessed members, e.g. Math.PI
+                while (at(index) == '.' && isIdentifierPart(at(index + 1)))
+                    for (++index; isIdentifierPart(at(index)); )
+                        ++index;
+                setFormat(begin, index - begin, mGlobalObjectFormat);
+            }
+            else {
+                auto next = index;
+                while (at(next).isSpace())
+                    ++next;
+                if (at(next) == '(')
+                    setFormat(begin, index - begin, mFunctionFormat);
+            }
+        }
+        else {
+            ++index;
+        }
+    }
+    return 0;
+}
 
-    rule.pattern = QRegularExpression("\\s+", QRegularExpression::UseUnicodePropertiesOption);
-    rule.format = whiteSpaceFormat;
-    mHighlightingRules.append(rule);
+} // namespace
 
-    mCommentStartExpression = QRegularExpression("/\\*");
-    mCommentEndExpression = QRegularExpression("\\*/");
+JsHighlighter::JsHighlighter(bool darkTheme, QObject *parent)
+    : SyntaxHighlighter(std::make_shared<JsLexer>(darkTheme), parent)
+{
+    auto completerStrings = QStringList();
+    for (const auto &keyword : keywords)
+        completerStrings.append(keyword);
+    for (const auto &global : globalObjects)
+        completerStrings.append(global);
 
     mCompleter = new QCompleter(this);
     completerStrings.sort(Qt::CaseInsensitive);
@@ -120,44 +208,3 @@ JsHighlighter::JsHighlighter(bool darkTheme, QObject *parent)
     mCompleter->setCaseSensitivity(Qt::CaseInsensitive);
     mCompleter->setWrapAround(false);
 }
-
-void JsHighlighter::highlightBlock(const QString &text)
-{
-    for (const HighlightingRule &rule : qAsConst(mHighlightingRules)) {
-        auto index = text.indexOf(rule.pattern);
-        while (index >= 0) {
-            const auto match = rule.pattern.match(text, index);
-            const auto length = match.capturedLength();
-            // do not start single line comment in string
-            if (format(index) == QTextCharFormat{ })
-                setFormat(index, length, rule.format);
-            index = text.indexOf(rule.pattern, index + length);
-        }
-    }
-    setCurrentBlockState(0);
-
-    auto startIndex = 0;
-    if (previousBlockState() != 1)
-        startIndex = text.indexOf(mCommentStartExpression);
-
-    while (startIndex >= 0) {
-        // do not start multiline comment in single line comment or string
-        if (startIndex && format(startIndex) != QTextCharFormat{ }) {
-            setCurrentBlockState(0);
-            break;
-        }
-
-        const auto match = mCommentEndExpression.match(text, startIndex);
-        const auto endIndex = match.capturedStart();
-        auto commentLength = 0;
-        if (endIndex == -1) {
-            setCurrentBlockState(1);
-            commentLength = text.length() - startIndex;
-        }
-        else {
-            commentLength = endIndex - startIndex + match.capturedLength();
-        }
-        setFormat(startIndex, commentLength, mCommentFormat);
-        startIndex = text.indexOf(mCommentStartExpression, startIndex + commentLength);
-    }
-}
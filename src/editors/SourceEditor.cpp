@@ -274,7 +274,7 @@ void SourceEditor::updateColors(bool darkTheme)
 void SourceEditor::updateSyntaxHighlighting()
 {
     const auto disabled =
-        (document()->characterCount() > (1 << 20) ||
+        (document()->characterCount() > (1 << 24) ||
          mSourceType == SourceType::PlainText);
 
     if (disabled) {
@@ -389,6 +389,10 @@ void SourceEditor::updateLineNumberArea(const QRect &rect, int dy)
 
     if (rect.contains(viewport()->rect()))
         updateViewportMargins();
+
+    if (mHighlighter)
+        mHighlighter->setVisibleBlocks(firstVisibleBlock().blockNumber(),
+            cursorForPosition(viewport()->rect().bottomLeft()).blockNumber());
 }
 
 void SourceEditor::paintEvent(QPaintEvent *event)
@@ -8,7 +8,7 @@
 
 class QPaintEvent;
 class QResizeEvent;
-class QSyntaxHighlighter;
+class SyntaxHighlighter;
 class QCompleter;
 class SourceEditorToolBar;
 
@@ -88,7 +88,7 @@ private:
     QString mFileName;
     FindReplaceBar &mFindReplaceBar;
     SourceType mSourceType{ SourceType::PlainText };
-    QSyntaxHighlighter *mHighlighter{ };
+    SyntaxHighlighter *mHighlighter{ };
     QCompleter *mCompleter{ };
     LineNumberArea *mLineNumberArea{ };
     QTextCharFormat mCurrentLineFormat;
@@ -0,0 +1,248 @@
+#include "SyntaxHighlighter.h"
+#include <QCoreApplication>
+#include <QRunnable>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QThreadPool>
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace {
+    // number of blocks highlighted and applied at once
+    const auto BatchSize = 256;
+
+    class HighlightTask final : public QRunnable
+    {
+    public:
+        explicit HighlightTask(std::function<void()> function)
+            : mFunction(std::move(function)) { }
+
+        void run() override { mFunction(); }
+
+    private:
+        const std::function<void()> mFunction;
+    };
+} // namespace
+
+SyntaxHighlighter::SyntaxHighlighter(std::shared_ptr<const Lexer> lexer,
+        QObject *parent)
+    : QObject(parent)
+    , mLexer(std::move(lexer))
+{
+}
+
+SyntaxHighlighter::~SyntaxHighlighter()
+{
+    clearFormats();
+}
+
+void SyntaxHighlighter::setDocument(QTextDocument *document)
+{
+    if (mDocument) {
+        disconnect(mDocument, nullptr, this, nullptr);
+        clearFormats();
+    }
+    mDocument = document;
+    ++mRevision;
+    mDirtyFrom = mDirtyTo = -1;
+    if (!mDocument)
+        return;
+
+    connect(mDocument, &QTextDocument::contentsChange,
+        this, &SyntaxHighlighter::handleContentsChange);
+
+    // user state is the state at the end of a block, -1 when not highlighted
+    for (auto block = mDocument->begin(); block.isValid(); block = block.next())
+        block.setUserState(-1);
+
+    mBlockCount = mDocument->blockCount();
+    mDirtyFrom = 0;
+    mDirtyTo = mBlockCount - 1;
+    scheduleJob();
+}
+
+void SyntaxHighlighter::setVisibleBlocks(int first, int last)
+{
+    mFirstVisible = first;
+    mLastVisible = last;
+    if (mDirtyFrom >= 0)
+        scheduleJob();
+}
+
+void SyntaxHighlighter::clearFormats()
+{
+    if (!mDocument)
+        return;
+
+    mApplyingFormats = true;
+    for (auto block = mDocument->begin(); block.isValid(); block = block.next()) {
+        block.layout()->clearFormats();
+        block.setUserState(-1);
+    }
+    mDocument->markContentsDirty(0, mDocument->characterCount());
+    mApplyingFormats = false;
+}
+
+void SyntaxHighlighter::handleContentsChange(int position, int removed, int added)
+{
+    Q_UNUSED(removed)
+    if (mApplyingFormats)
+        return;
+
+    ++mRevision;
+
+    // changed blocks need to be highlighted again
+    auto block = mDocument->findBlock(position);
+    const auto last = mDocument->findBlock(position + added);
+    const auto first = block.blockNumber();
+    for (; block.isValid(); block = block.next()) {
+        block.setUserState(-1);
+        if (block == last)
+            break;
+    }
+
+    const auto blockCount = mDocument->blockCount();
+    const auto lastNumber = (last.isValid() ?
+        last.blockNumber() : blockCount - 1);
+    if (mDirtyFrom < 0) {
+        mDirtyFrom = first;
+        mDirtyTo = lastNumber;
+    }
+    else {
+        // blocks after the change were shifted
+        if (mDirtyTo > first)
+            mDirtyTo += blockCount - mBlockCount;
+        mDirtyFrom = std::min(mDirtyFrom, first);
+        mDirtyTo = std::max(mDirtyTo, lastNumber);
+    }
+    mDirtyTo = std::clamp(mDirtyTo, mDirtyFrom, blockCount - 1);
+    mBlockCount = blockCount;
+    scheduleJob();
+}
+
+void SyntaxHighlighter::scheduleJob()
+{
+    // coalesce changes of one event loop iteration
+    if (std::exchange(mJobScheduled, true))
+        return;
+
+    QMetaObject::invokeMethod(this, [this]() {
+        mJobScheduled = false;
+        startJob();
+    }, Qt::QueuedConnection);
+}
+
+void SyntaxHighlighter::startJob()
+{
+    if (mJobRunning || !mDocument || mDirtyFrom < 0)
+        return;
+
+    auto job = Job{ };
+    job.revision = mRevision;
+    job.firstBlock = mDirtyFrom;
+    auto count = BatchSize;
+
+    // when far below the first modified block, highlight visible blocks
+    // first, assuming the state before them is still valid
+    if (mFirstVisible > mDirtyFrom + BatchSize && mLastVisible >= mFirstVisible) {
+        auto block = mDocument->findBlockByNumber(mFirstVisible);
+        for (auto i = mFirstVisible; i <= mLastVisible && block.isValid();
+                ++i, block = block.next())
+            if (block.userState() == -1) {
+                job.firstBlock = mFirstVisible;
+                job.speculative = true;
+                count = mLastVisible - mFirstVisible + 1;
+                break;
+            }
+    }
+
+    auto block = mDocument->findBlockByNumber(job.firstBlock);
+    job.previousState = block.previous().userState();
+    for (auto i = 0; i < count && block.isValid(); ++i, block = block.next()) {
+        job.texts.append(block.text());
+        job.storedStates.append(block.userState());
+    }
+    job.storedStates.append(block.isValid() ? block.userState() : 0);
+
+    if (job.texts.isEmpty()) {
+        mDirtyFrom = mDirtyTo = -1;
+        return;
+    }
+
+    // all highlighters share the threads of the global pool,
+    // a running job does not keep its highlighter alive
+    mJobRunning = true;
+    auto highlighter = QPointer<SyntaxHighlighter>(this);
+    QThreadPool::globalInstance()->start(new HighlightTask(
+        [highlighter, lexer = mLexer, job = std::move(job)]() mutable {
+            // stop as soon as a block ends in the state it ended before
+            // and the following block was not modified
+            auto state = job.previousState;
+            for (auto i = 0; i < job.texts.size(); ++i) {
+                auto formats = FormatRanges();
+                state = lexer->highlightBlock(job.texts[i], state, formats);
+                job.formats.append(std::move(formats));
+                job.states.append(state);
+                if (!job.speculative && state == job.storedStates[i] &&
+                    job.storedStates[i + 1] != -1) {
+                    job.stable = true;
+                    break;
+                }
+            }
+            QMetaObject::invokeMethod(QCoreApplication::instance(),
+                [highlighter, job = std::move(job)]() {
+                    if (highlighter)
+                        highlighter->finishJob(job);
+                }, Qt::QueuedConnection);
+        }));
+}
+
+void SyntaxHighlighter::finishJob(const Job &job)
+{
+    mJobRunning = false;
+
+    // discard result when document was modified in the meantime
+    if (!mDocument || job.revision != mRevision) {
+        startJob();
+        return;
+    }
+
+    mApplyingFormats = true;
+    auto block = mDocument->findBlockByNumber(job.firstBlock);
+    auto changedBegin = -1;
+    auto changedEnd = -1;
+    for (auto i = 0; i < job.states.size() && block.isValid();
+            ++i, block = block.next()) {
+        auto layout = block.layout();
+        if (layout->formats() != job.formats[i]) {
+            layout->setFormats(job.formats[i]);
+            if (changedBegin < 0)
+                changedBegin = block.position();
+            changedEnd = block.position() + block.length();
+        }
+        block.setUserState(job.states[i]);
+    }
+    if (changedBegin >= 0)
+        mDocument->markContentsDirty(changedBegin, changedEnd - changedBegin);
+    mApplyingFormats = false;
+
+    if (!job.speculative) {
+        if (job.stable || !block.isValid()) {
+            // continue with next modified block
+            auto next = job.firstBlock + static_cast<int>(job.states.size());
+            mDirtyFrom = -1;
+            for (; block.isValid() && next <= mDirtyTo; ++next, block = block.next())
+                if (block.userState() == -1) {
+                    mDirtyFrom = next;
+                    break;
+                }
+            if (mDirtyFrom < 0)
+                mDirtyTo = -1;
+        }
+        else {
+            mDirtyFrom = job.firstBlock + static_cast<int>(job.states.size());
+        }
+    }
+    startJob();
+}
@@ -0,0 +1,70 @@
+#ifndef SYNTAXHIGHLIGHTER_H
+#define SYNTAXHIGHLIGHTER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTextLayout>
+#include <memory>
+
+class QTextDocument;
+
+// highlights the blocks of a document on a shared thread pool, visible
+// blocks first, and applies the formats in batches
+class SyntaxHighlighter : public QObject
+{
+    Q_OBJECT
+public:
+    using FormatRanges = QVector<QTextLayout::FormatRange>;
+
+    class Lexer
+    {
+    public:
+        virtual ~Lexer() = default;
+
+        // called in background thread, returns state at end of block
+        virtual int highlightBlock(const QString &text,
+            int previousState, FormatRanges &formats) const = 0;
+    };
+
+    ~SyntaxHighlighter() override;
+
+    void setDocument(QTextDocument *document);
+    void setVisibleBlocks(int first, int last);
+
+protected:
+    SyntaxHighlighter(std::shared_ptr<const Lexer> lexer, QObject *parent);
+
+private:
+    struct Job
+    {
+        int revision;
+        int firstBlock;
+        int previousState;
+        bool speculative;
+        QStringList texts;
+        QVector<int> storedStates;
+        QVector<FormatRanges> formats;
+        QVector<int> states;
+        bool stable;
+    };
+
+    void handleContentsChange(int position, int removed, int added);
+    void scheduleJob();
+    void startJob();
+    void finishJob(const Job &job);
+    void clearFormats();
+
+    const std::shared_ptr<const Lexer> mLexer;
+    QPointer<QTextDocument> mDocument;
+    int mRevision{ };
+    int mBlockCount{ };
+    int mDirtyFrom{ -1 };
+    int mDirtyTo{ -1 };
+    int mFirstVisible{ };
+    int mLastVisible{ -1 };
+    bool mJobScheduled{ };
+    bool mJobRunning{ };
+    bool mApplyingFormats{ };
+};
+
+#endif // SYNTAXHIGHLIGHTER_H
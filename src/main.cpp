@@ -2,6 +2,8 @@
 #include "SingleApplication/singleapplication.h"
 #include "render/CompositorSync.h"
 #include "FileDialog.h"
+#include "BatchRenderer.h"
+#include "Singletons.h"
 #include <QApplication>
 #include <QStyleFactory>
 
@@ -38,6 +40,22 @@ int main(int argc, char *argv[])
 #endif
 
     QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+
+    if (BatchRenderer::isRequested(argc, argv)) {
+        // neither window nor single instance, by default also no display
+        if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+
+        QGuiApplication app(argc, argv);
+        QLocale::setDefault(QLocale::c());
+        app.setOrganizationName("gpupad");
+        app.setApplicationName("GPUpad");
+
+        Singletons singletons(nullptr);
+        BatchRenderer batchRenderer;
+        return batchRenderer.exec(app.arguments());
+    }
+
     QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
 
     initializeCompositorSync();
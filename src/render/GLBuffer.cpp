@@ -1,4 +1,5 @@
 #include "GLBuffer.h"
+#include <cstring>
 
 int getBufferSize(const Buffer &buffer,
     ScriptEngine &scriptEngine, MessagePtrSet &messages)
@@ -114,16 +115,29 @@ void GLBuffer::unbind(GLenum target)
 void GLBuffer::reload()
 {
     auto prevData = mData;
+    auto modifiedRange = std::make_pair(0, mSize);
     if (!mFileName.isEmpty())
-        if (!Singletons::fileCache().getBinary(mFileName, &mData))
+        if (!Singletons::fileCache().getBinary(mFileName,
+                &mData, prevData, &modifiedRange, &mMappedFile, &mMappedVersion))
             if (!FileDialog::isEmptyOrUntitled(mFileName))
                 mMessages += MessageList::insert(
                     mItemId, MessageType::LoadingFileFailed, mFileName);
 
+    // data is not padded, remaining range is cleared on upload
+    if (mData.isSharedWith(prevData))
+        return;
+
     if (mSize > mData.size())
-        mData.append(QByteArray(mSize - mData.size(), 0));
+        modifiedRange = { 0, mSize };
 
-    mSystemCopyModified |= !mData.isSharedWith(prevData);
+    if (mSystemCopyModified) {
+        mModifiedRange.first = std::min(mModifiedRange.first, modifiedRange.first);
+        mModifiedRange.second = std::max(mModifiedRange.second, modifiedRange.second);
+    }
+    else {
+        mModifiedRange = modifiedRange;
+        mSystemCopyModified = true;
+    }
 }
 
 void GLBuffer::createBuffer()
@@ -146,6 +160,9 @@ void GLBuffer::createBuffer()
     gl.glBindBuffer(GL_ARRAY_BUFFER, mBufferObject);
     gl.glBufferData(GL_ARRAY_BUFFER, mSize, nullptr, GL_DYNAMIC_DRAW);
     gl.glBindBuffer(GL_ARRAY_BUFFER, GL_NONE);
+
+    mSystemCopyModified = true;
+    mModifiedRange = { 0, mSize };
 }
 
 void GLBuffer::upload()
@@ -153,19 +170,85 @@ void GLBuffer::upload()
     if (!mSystemCopyModified)
         return;
 
+    // only upload modified range, unless device copy was also modified
+    auto begin = std::max(mModifiedRange.first, 0);
+    auto end = std::min(mModifiedRange.second, mSize);
+    if (mDeviceCopyModified) {
+        begin = 0;
+        end = mSize;
+    }
+
+    // data might be a memory mapped file, which is uploaded directly
+    const auto dataEnd = std::min(end, static_cast<int>(mData.size()));
     auto &gl = GLContext::currentContext();
     gl.glBindBuffer(GL_ARRAY_BUFFER, mBufferObject);
-    gl.glBufferSubData(GL_ARRAY_BUFFER, 0, mSize, mData.constData());
+    if (begin < dataEnd)
+        gl.glBufferSubData(GL_ARRAY_BUFFER, begin, dataEnd - begin,
+            mData.constData() + begin);
+    clearRange(std::max(begin, dataEnd), end);
     gl.glBindBuffer(GL_ARRAY_BUFFER, GL_NONE);
 
+    // mapping is released once uploaded, so the file can be replaced,
+    // it is only mapped again when the version in the file cache changes
+    releaseMappedFile(false);
     mSystemCopyModified = mDeviceCopyModified = false;
 }
 
+void GLBuffer::restoreMappedFile()
+{
+    // released system copy is mapped again for comparing the device copy
+    if (!mData.isEmpty() || !mMappedVersion)
+        return;
+
+    auto version = quint64{ };
+    auto modifiedRange = std::pair<int, int>();
+    Singletons::fileCache().getBinary(mFileName, &mData, { },
+        &modifiedRange, &mMappedFile, &version);
+}
+
+void GLBuffer::releaseMappedFile(bool systemCopyModified)
+{
+    // a modified system copy is no longer referencing the mapping,
+    // an unmodified one is mapped again when it is needed
+    if (!mMappedFile)
+        return;
+    if (!systemCopyModified)
+        mData = { };
+    mMappedFile.reset();
+}
+
+void GLBuffer::clearRange(int begin, int end)
+{
+    if (begin >= end)
+        return;
+
+    auto &gl = GLContext::currentContext();
+#if GL_VERSION_4_3
+    if (gl.v4_3) {
+        auto data = uint8_t();
+        gl.v4_3->glClearBufferSubData(GL_ARRAY_BUFFER, GL_R8,
+            begin, end - begin, GL_RED, GL_UNSIGNED_BYTE, &data);
+        return;
+    }
+#endif
+    gl.glBufferSubData(GL_ARRAY_BUFFER, begin, end - begin,
+        QByteArray(end - begin, 0).constData());
+}
+
+void GLBuffer::resizeSystemCopy()
+{
+    // device copy is downloaded to system copy, which is only padded here
+    if (mData.size() < mSize)
+        mData.append(QByteArray(mSize - mData.size(), 0));
+}
+
 bool GLBuffer::download()
 {
     if (!mDeviceCopyModified)
         return false;
 
+    restoreMappedFile();
+    resizeSystemCopy();
     const auto prevData = mData;
     auto &gl = GLContext::currentContext();
     gl.glBindBuffer(GL_ARRAY_BUFFER, mBufferObject);
@@ -174,9 +257,66 @@ bool GLBuffer::download()
 
     if (prevData == mData) {
         mData = prevData;
+        releaseMappedFile(false);
+        return false;
+    }
+
+    mSystemCopyModified = mDeviceCopyModified = false;
+    releaseMappedFile(true);
+    return true;
+}
+
+bool GLBuffer::beginDownload()
+{
+    if (!mDeviceCopyModified)
+        return false;
+
+    auto &gl = GLContext::currentContext();
+    if (!mDownloadBuffer) {
+        auto createBuffer = [&]() {
+          auto buffer = GLuint{};
+          gl.glGenBuffers(1, &buffer);
+          return buffer;
+        };
+        auto freeBuffer = [](GLuint buffer) {
+          auto &gl = GLContext::currentContext();
+          gl.glDeleteBuffers(1, &buffer);
+        };
+        mDownloadBuffer = GLObject(createBuffer(), freeBuffer);
+        gl.glBindBuffer(GL_COPY_WRITE_BUFFER, mDownloadBuffer);
+        gl.glBufferData(GL_COPY_WRITE_BUFFER, mSize, nullptr, GL_STREAM_READ);
+    }
+    else {
+        gl.glBindBuffer(GL_COPY_WRITE_BUFFER, mDownloadBuffer);
+    }
+    gl.glBindBuffer(GL_COPY_READ_BUFFER, mBufferObject);
+    gl.glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, mSize);
+    gl.glBindBuffer(GL_COPY_READ_BUFFER, GL_NONE);
+    gl.glBindBuffer(GL_COPY_WRITE_BUFFER, GL_NONE);
+    return true;
+}
+
+bool GLBuffer::finishDownload()
+{
+    restoreMappedFile();
+    resizeSystemCopy();
+    auto &gl = GLContext::currentContext();
+    gl.glBindBuffer(GL_COPY_READ_BUFFER, mDownloadBuffer);
+    const auto data = static_cast<const char*>(gl.glMapBufferRange(
+        GL_COPY_READ_BUFFER, 0, mSize, GL_MAP_READ_BIT));
+    const auto modified = (data && std::memcmp(data, mData.constData(), mSize));
+    if (modified)
+        std::memcpy(mData.data(), data, mSize);
+    if (data)
+        gl.glUnmapBuffer(GL_COPY_READ_BUFFER);
+    gl.glBindBuffer(GL_COPY_READ_BUFFER, GL_NONE);
+
+    if (!modified) {
+        releaseMappedFile(false);
         return false;
     }
 
     mSystemCopyModified = mDeviceCopyModified = false;
+    releaseMappedFile(true);
     return true;
 }
@@ -3,6 +3,9 @@
 
 #include "GLItem.h"
 #include "scripting/ScriptEngine.h"
+#include <memory>
+
+class QFile;
 
 class GLBuffer
 {
@@ -24,19 +27,29 @@ public:
     void bindIndexedRange(GLenum target, int index, int offset, int size, bool readonly);
     void unbind(GLenum target);
     bool download();
+    bool beginDownload();
+    bool finishDownload();
 
 private:
     void reload();
     void createBuffer();
     void upload();
+    void clearRange(int begin, int end);
+    void resizeSystemCopy();
+    void restoreMappedFile();
+    void releaseMappedFile(bool systemCopyModified);
 
     MessagePtrSet mMessages;
     ItemId mItemId{ };
     QString mFileName;
     int mSize{ };
     QByteArray mData;
+    std::shared_ptr<const QFile> mMappedFile;
+    quint64 mMappedVersion{ };
     QSet<ItemId> mUsedItems;
     GLObject mBufferObject;
+    GLObject mDownloadBuffer;
+    std::pair<int, int> mModifiedRange;
     bool mSystemCopyModified{ };
     bool mDeviceCopyModified{ };
 };
@@ -4,9 +4,9 @@
 #include "GLProgram.h"
 #include "GLTarget.h"
 #include "GLStream.h"
+#include "GLHazardTracker.h"
 #include "Renderer.h"
 #include <QOpenGLTimerQuery>
-#include <QOpenGLVertexArrayObject>
 
 GLCall::GLCall(const Call &call, ScriptEngine &scriptEngine)
     : mCall(call)
@@ -88,15 +88,79 @@ void GLCall::setTextures(GLTexture *texture, GLTexture *fromTexture)
     mFromTexture = fromTexture;
 }
 
+std::shared_ptr<const QOpenGLTimerQuery> GLCall::timerQuery() const
+{
+    if (mTimerQueryIndex < 0)
+        return nullptr;
+    return mTimerQueries[static_cast<size_t>(mTimerQueryIndex)];
+}
+
 std::shared_ptr<void> GLCall::beginTimerQuery()
 {
-    if (!mTimerQuery) {
-        mTimerQuery = std::make_shared<QOpenGLTimerQuery>();
-        mTimerQuery->create();
+    // a few queries are used in turn, so their results can be collected
+    // frames later without waiting. prefer one nobody is waiting for
+    const auto maxTimerQueries = 3;
+    const auto count = static_cast<int>(mTimerQueries.size());
+    auto index = -1;
+    for (auto i = 1; i <= count && index < 0; ++i) {
+        const auto next = (mTimerQueryIndex + i) % count;
+        if (mTimerQueries[static_cast<size_t>(next)].use_count() == 1)
+            index = next;
+    }
+    if (index < 0) {
+        if (count < maxTimerQueries) {
+            auto timerQuery = std::make_shared<QOpenGLTimerQuery>();
+            timerQuery->create();
+            mTimerQueries.push_back(std::move(timerQuery));
+            index = count;
+        }
+        else {
+            index = (mTimerQueryIndex + 1) % count;
+        }
     }
-    mTimerQuery->begin();
+    mTimerQueryIndex = index;
+
+    auto timerQuery = mTimerQueries[static_cast<size_t>(index)].get();
+    timerQuery->begin();
     return std::shared_ptr<void>(nullptr,
-        [this](void*) { mTimerQuery->end(); });
+        [timerQuery](void*) { timerQuery->end(); });
+}
+
+void GLCall::trackResources(GLHazardTracker &tracker) const
+{
+    using Access = GLHazardTracker::Access;
+    switch (mCall.callType) {
+        case Call::CallType::Draw:
+        case Call::CallType::DrawIndexed:
+        case Call::CallType::DrawIndirect:
+        case Call::CallType::DrawIndexedIndirect:
+            if (mTarget)
+                mTarget->trackResources(tracker);
+            if (mVertexStream)
+                mVertexStream->trackResources(tracker);
+            tracker.read(mIndexBuffer, Access::ElementArray);
+            tracker.read(mIndirectBuffer, Access::Command);
+            break;
+
+        case Call::CallType::Compute:
+        case Call::CallType::ComputeIndirect:
+            tracker.read(mIndirectBuffer, Access::Command);
+            break;
+
+        case Call::CallType::ClearTexture:
+        case Call::CallType::CopyTexture:
+            tracker.read(mTexture, Access::TextureUpdate);
+            tracker.read(mTexture, Access::Framebuffer);
+            tracker.read(mFromTexture, Access::TextureUpdate);
+            tracker.read(mFromTexture, Access::Framebuffer);
+            break;
+
+        case Call::CallType::ClearBuffer:
+        case Call::CallType::CopyBuffer:
+            tracker.read(mBuffer, Access::BufferUpdate);
+            tracker.read(mFromBuffer, Access::BufferUpdate);
+            break;
+    }
 }
 
 void GLCall::execute(MessagePtrSet &messages)
@@ -126,12 +190,6 @@ void GLCall::execute(MessagePtrSet &messages)
             break;
     }
 
-#if GL_VERSION_4_2
-    auto &gl = GLContext::currentContext();
-    if (gl.v4_2)
-        gl.v4_2->glMemoryBarrier(GL_ALL_BARRIER_BITS);
-#endif
-
     const auto error = glGetError();
     if (error != GL_NO_ERROR)
         messages += MessageList::insert(
@@ -140,9 +198,6 @@ void GLCall::execute(MessagePtrSet &messages)
 
 void GLCall::executeDraw(MessagePtrSet &messages)
 {
-    QOpenGLVertexArrayObject vao;
-    QOpenGLVertexArrayObject::Binder vaoBinder(&vao);
-
     if (mTarget) {
         mTarget->bind();
     }
@@ -151,8 +206,12 @@ void GLCall::executeDraw(MessagePtrSet &messages)
             mCall.id, MessageType::TargetNotAssigned);
     }
 
-    if (mVertexStream && mProgram)
+    if (mVertexStream && mProgram) {
         mVertexStream->bind(*mProgram);
+    }
+    else {
+        bindEmptyVertexArray();
+    }
 
     if (mIndexBuffer)
         mIndexBuffer->bindReadOnly(GL_ELEMENT_ARRAY_BUFFER);
@@ -240,6 +299,9 @@ void GLCall::executeDraw(MessagePtrSet &messages)
     if (mIndexBuffer)
         mIndexBuffer->unbind(GL_ELEMENT_ARRAY_BUFFER);
 
+    auto &gl = GLContext::currentContext();
+    gl.glBindVertexArray(GL_NONE);
+
     if (mVertexStream)
         mUsedItems += mVertexStream->usedItems();
 
@@ -247,6 +309,25 @@ void GLCall::executeDraw(MessagePtrSet &messages)
         mUsedItems += mTarget->usedItems();
 }
 
+void GLCall::bindEmptyVertexArray()
+{
+    // drawing without attributes still requires a vertex array object
+    auto &gl = GLContext::currentContext();
+    if (!mEmptyVertexArray) {
+        auto createVertexArray = [&]() {
+            auto vertexArray = GLuint{ };
+            gl.glGenVertexArrays(1, &vertexArray);
+            return vertexArray;
+        };
+        auto freeVertexArray = [](GLuint vertexArray) {
+            auto &gl = GLContext::currentContext();
+            gl.glDeleteVertexArrays(1, &vertexArray);
+        };
+        mEmptyVertexArray = GLObject(createVertexArray(), freeVertexArray);
+    }
+    gl.glBindVertexArray(mEmptyVertexArray);
+}
+
 void GLCall::executeCompute(MessagePtrSet &messages)
 {
 #if GL_VERSION_4_3
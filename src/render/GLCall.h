@@ -11,6 +11,7 @@ class GLTarget;
 class GLStream;
 class GLBuffer;
 class GLTexture;
+class GLHazardTracker;
 
 class GLCall
 {
@@ -19,7 +20,7 @@ public:
 
     ItemId itemId() const { return mCall.id; }
     GLProgram *program() { return mProgram; }
-    std::shared_ptr<const QOpenGLTimerQuery> timerQuery() const { return mTimerQuery; }
+    std::shared_ptr<const QOpenGLTimerQuery> timerQuery() const;
     const QSet<ItemId> &usedItems() const { return mUsedItems; }
 
     void setProgram(GLProgram *program);
@@ -31,6 +32,7 @@ public:
         ScriptEngine &scriptEngine);
     void setBuffers(GLBuffer *buffer, GLBuffer *fromBuffer);
     void setTextures(GLTexture *texture, GLTexture *fromTexture);
+    void trackResources(GLHazardTracker &tracker) const;
     void execute(MessagePtrSet &messages);
 
 private:
@@ -42,6 +44,7 @@ private:
     void executeClearBuffer(MessagePtrSet &messages);
     void executeCopyBuffer(MessagePtrSet &messages);
     GLenum getIndexType() const;
+    void bindEmptyVertexArray();
 
     MessagePtrSet mMessages;
     Call mCall{ };
@@ -60,6 +63,7 @@ private:
 
     GLBuffer *mIndirectBuffer{ };
     GLint mIndirectStride{ };
+    GLObject mEmptyVertexArray;
 
     ScriptVariable mFirst;
     ScriptVariable mCount;
@@ -73,7 +77,8 @@ private:
     ScriptVariable mWorkgroupsZ;
 
     QSet<ItemId> mUsedItems;
-    std::shared_ptr<QOpenGLTimerQuery> mTimerQuery;
+    std::vector<std::shared_ptr<QOpenGLTimerQuery>> mTimerQueries;
+    int mTimerQueryIndex{ -1 };
 };
 
 #endif // GLCALL_H
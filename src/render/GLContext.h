@@ -5,6 +5,7 @@
 #include <QOpenGLFunctions>
 #include <QOpenGLFunctions_3_3_Core>
 #include <QOpenGLFunctions_4_0_Core>
+#include <QOpenGLFunctions_4_1_Core>
 #include <QOpenGLFunctions_4_2_Core>
 #include <QOpenGLFunctions_4_3_Core>
 #include <QOpenGLFunctions_4_5_Core>
@@ -25,6 +26,7 @@ public:
     }
 
     QOpenGLFunctions_4_0_Core *v4_0{ };
+    QOpenGLFunctions_4_1_Core *v4_1{ };
     QOpenGLFunctions_4_2_Core *v4_2{ };
     QOpenGLFunctions_4_3_Core *v4_3{ };
     QOpenGLFunctions_4_5_Core *v4_5{ };
@@ -36,15 +38,18 @@ public:
 
 #if (QT_VERSION > QT_VERSION_CHECK(6, 0, 0))
         v4_0 = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_4_0_Core>();
+        v4_1 = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_4_1_Core>();
         v4_2 = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_4_2_Core>();
         v4_3 = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_4_3_Core>();
         v4_5 = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_4_5_Core>();
 #else
         v4_0 = versionFunctions<QOpenGLFunctions_4_0_Core>();
+        v4_1 = versionFunctions<QOpenGLFunctions_4_1_Core>();
         v4_2 = versionFunctions<QOpenGLFunctions_4_2_Core>();
         v4_3 = versionFunctions<QOpenGLFunctions_4_3_Core>();
         v4_5 = versionFunctions<QOpenGLFunctions_4_5_Core>();
 #endif
+        enableParallelShaderCompile();
         return true;
     }
 
@@ -52,6 +57,23 @@ public:
     {
         return isInitialized();
     }
+
+private:
+    void enableParallelShaderCompile()
+    {
+        using MaxShaderCompilerThreads = void (QOPENGLF_APIENTRYP)(GLuint count);
+        auto maxShaderCompilerThreads = MaxShaderCompilerThreads{ };
+        if (hasExtension("GL_KHR_parallel_shader_compile"))
+            maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreads>(
+                getProcAddress("glMaxShaderCompilerThreadsKHR"));
+        else if (hasExtension("GL_ARB_parallel_shader_compile"))
+            maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreads>(
+                getProcAddress("glMaxShaderCompilerThreadsARB"));
+
+        // let driver choose number of threads
+        if (maxShaderCompilerThreads)
+            maxShaderCompilerThreads(0xFFFFFFFF);
+    }
 };
 
 #endif // GLCONTEXT_H
@@ -0,0 +1,174 @@
+#include "GLHazardTracker.h"
+#include "GLTexture.h"
+#include "GLBuffer.h"
+
+namespace {
+    GLbitfield getBarrierBit(GLHazardTracker::Access access)
+    {
+        using Access = GLHazardTracker::Access;
+#if GL_VERSION_4_3
+        switch (access) {
+            case Access::VertexAttribute: return GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT;
+            case Access::ElementArray: return GL_ELEMENT_ARRAY_BARRIER_BIT;
+            case Access::Uniform: return GL_UNIFORM_BARRIER_BIT;
+            case Access::TextureFetch: return GL_TEXTURE_FETCH_BARRIER_BIT;
+            case Access::ShaderImage: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+            case Access::Command: return GL_COMMAND_BARRIER_BIT;
+            case Access::TextureUpdate: return GL_TEXTURE_UPDATE_BARRIER_BIT;
+            case Access::BufferUpdate: return GL_BUFFER_UPDATE_BARRIER_BIT;
+            case Access::Framebuffer: return GL_FRAMEBUFFER_BARRIER_BIT;
+            case Access::AtomicCounter: return GL_ATOMIC_COUNTER_BARRIER_BIT;
+            case Access::ShaderStorage: return GL_SHADER_STORAGE_BARRIER_BIT;
+        }
+#else
+        Q_UNUSED(access);
+#endif
+        return 0;
+    }
+
+    GLbitfield allBarrierBits()
+    {
+#if GL_VERSION_4_2
+        return GL_ALL_BARRIER_BITS;
+#else
+        return 0;
+#endif
+    }
+} // namespace
+
+GLHazardTracker::GLHazardTracker(bool enabled)
+    : mEnabled(enabled)
+{
+}
+
+const void *GLHazardTracker::getResource(const GLTexture *texture) const
+{
+    // texture buffers are accessed through their buffer
+    if (texture && texture->textureBuffer())
+        return texture->textureBuffer();
+    return texture;
+}
+
+void GLHazardTracker::read(const GLTexture *texture, Access access)
+{
+    read(getResource(texture), access);
+}
+
+void GLHazardTracker::read(const GLBuffer *buffer, Access access)
+{
+    read(static_cast<const void*>(buffer), access);
+}
+
+void GLHazardTracker::write(const GLTexture *texture, Access access)
+{
+    write(getResource(texture), access);
+}
+
+void GLHazardTracker::write(const GLBuffer *buffer, Access access)
+{
+    write(static_cast<const void*>(buffer), access);
+}
+
+void GLHazardTracker::bindBuffer(const GLBuffer *buffer,
+    GLenum target, bool readonly)
+{
+    switch (target) {
+        case GL_UNIFORM_BUFFER:
+            read(buffer, Access::Uniform);
+            break;
+
+#if GL_VERSION_4_2
+        case GL_ATOMIC_COUNTER_BUFFER:
+            write(buffer, Access::AtomicCounter);
+            break;
+#endif
+
+#if GL_VERSION_4_3
+        case GL_SHADER_STORAGE_BUFFER:
+            if (readonly) {
+                read(buffer, Access::ShaderStorage);
+            }
+            else {
+                write(buffer, Access::ShaderStorage);
+            }
+            break;
+#endif
+    }
+    Q_UNUSED(readonly);
+}
+
+void GLHazardTracker::read(const void *resource, Access access)
+{
+    if (!mEnabled || !resource)
+        return;
+
+    const auto it = mPendingBarrierBits.find(resource);
+    if (it == mPendingBarrierBits.end())
+        return;
+
+    const auto barrierBit = getBarrierBit(access);
+    if (it->second & barrierBit)
+        mRequiredBarrierBits |= barrierBit;
+}
+
+void GLHazardTracker::write(const void *resource, Access access)
+{
+    // writes also need to wait for previous writes
+    read(resource, access);
+
+    if (mEnabled && resource)
+        mWrites.push_back(resource);
+}
+
+void GLHazardTracker::beginCall()
+{
+    if (!mRequiredBarrierBits)
+        return;
+
+    memoryBarrier(mRequiredBarrierBits);
+
+    // barriers are global, they make all pending writes visible
+    for (auto it = mPendingBarrierBits.begin(); it != mPendingBarrierBits.end(); ) {
+        it->second &= ~mRequiredBarrierBits;
+        if (!it->second) {
+            it = mPendingBarrierBits.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    mRequiredBarrierBits = { };
+}
+
+void GLHazardTracker::endCall()
+{
+    if (!mEnabled) {
+        memoryBarrier(allBarrierBits());
+        return;
+    }
+
+    for (auto resource : mWrites)
+        mPendingBarrierBits[resource] = allBarrierBits();
+    mWrites.clear();
+}
+
+void GLHazardTracker::finish()
+{
+    // make all writes visible before resources are read back
+    if (mPendingBarrierBits.empty())
+        return;
+
+    memoryBarrier(allBarrierBits());
+    mPendingBarrierBits.clear();
+}
+
+void GLHazardTracker::memoryBarrier(GLbitfield barrierBits)
+{
+#if GL_VERSION_4_2
+    auto &gl = GLContext::currentContext();
+    if (gl.v4_2 && barrierBits)
+        gl.v4_2->glMemoryBarrier(barrierBits);
+#else
+    Q_UNUSED(barrierBits);
+#endif
+}
@@ -0,0 +1,55 @@
+#ifndef GLHAZARDTRACKER_H
+#define GLHAZARDTRACKER_H
+
+#include "GLItem.h"
+#include <map>
+#include <vector>
+
+class GLTexture;
+class GLBuffer;
+
+// tracks incoherent shader writes (images, storage buffers, atomic counters)
+// and issues only the memory barriers required by the following accesses
+class GLHazardTracker
+{
+public:
+    enum class Access
+    {
+        VertexAttribute,
+        ElementArray,
+        Uniform,
+        TextureFetch,
+        ShaderImage,
+        Command,
+        TextureUpdate,
+        BufferUpdate,
+        Framebuffer,
+        AtomicCounter,
+        ShaderStorage,
+    };
+
+    // when disabled, a full barrier is issued after each call
+    explicit GLHazardTracker(bool enabled);
+
+    void read(const GLTexture *texture, Access access);
+    void read(const GLBuffer *buffer, Access access);
+    void write(const GLTexture *texture, Access access);
+    void write(const GLBuffer *buffer, Access access);
+    void bindBuffer(const GLBuffer *buffer, GLenum target, bool readonly);
+    void beginCall();
+    void endCall();
+    void finish();
+
+private:
+    const void *getResource(const GLTexture *texture) const;
+    void read(const void *resource, Access access);
+    void write(const void *resource, Access access);
+    void memoryBarrier(GLbitfield barrierBits);
+
+    bool mEnabled{ };
+    std::map<const void*, GLbitfield> mPendingBarrierBits;
+    std::vector<const void*> mWrites;
+    GLbitfield mRequiredBarrierBits{ };
+};
+
+#endif // GLHAZARDTRACKER_H
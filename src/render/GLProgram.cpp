@@ -2,8 +2,120 @@
 #include "GLTexture.h"
 #include "GLBuffer.h"
 #include "scripting/ScriptEngine.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <array>
-#include <QRegularExpression>
+
+namespace {
+    QString getProgramBinaryFileName(const QByteArray &key)
+    {
+        static const auto directory = QStandardPaths::writableLocation(
+            QStandardPaths::CacheLocation) + "/programs/";
+        return directory + QString::fromUtf8(key.toHex()) + ".bin";
+    }
+
+    // key is generated from driver and patched sources
+    QByteArray getProgramBinaryKey(GLContext &gl,
+        const std::vector<GLShader> &shaders,
+        const std::vector<QStringList> &patchedSources)
+    {
+        auto hash = QCryptographicHash(QCryptographicHash::Sha256);
+        for (auto name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+            hash.addData(QByteArray(reinterpret_cast<const char*>(gl.glGetString(name))));
+        for (auto i = 0u; i < shaders.size(); ++i) {
+            hash.addData(QByteArray::number(static_cast<int>(shaders[i].type())));
+            for (const auto &source : patchedSources[i])
+                hash.addData(source.toUtf8());
+        }
+        return hash.result();
+    }
+
+    // removes least recently used binaries, when cache exceeds its size
+    void evictProgramBinaries(const QString &directory)
+    {
+        const auto maxCacheSize = qint64{ 64 } * 1024 * 1024;
+        auto cacheSize = qint64{ };
+        const auto files = QDir(directory).entryInfoList(
+            { "*.bin" }, QDir::Files, QDir::Time);
+        for (const auto &file : files) {
+            cacheSize += file.size();
+            if (cacheSize > maxCacheSize)
+                QFile::remove(file.absoluteFilePath());
+        }
+    }
+
+    // file contains the binary and the info logs of the shaders and the program
+    bool loadProgramBinary(GLContext &gl, GLuint program,
+        const QByteArray &key, int shaderCount, QStringList *infoLogs)
+    {
+#if GL_VERSION_4_1
+        if (auto gl41 = gl.v4_1) {
+            auto file = QFile(getProgramBinaryFileName(key));
+            if (!file.open(QFile::ReadOnly))
+                return false;
+
+            QDataStream stream(&file);
+            stream.setVersion(QDataStream::Qt_5_12);
+            auto format = quint32{ };
+            auto binary = QByteArray();
+            stream >> format >> *infoLogs >> binary;
+            if (stream.status() != QDataStream::Ok || binary.isEmpty() ||
+                infoLogs->size() != shaderCount + 1)
+                return false;
+            gl41->glProgramBinary(program, static_cast<GLenum>(format),
+                binary.constData(), static_cast<GLsizei>(binary.size()));
+
+            // binary is rejected when driver changed
+            auto status = GLint{ };
+            gl.glGetProgramiv(program, GL_LINK_STATUS, &status);
+            if (status != GL_TRUE)
+                return false;
+
+            // keep recently used binaries on eviction,
+            // setting the time requires write access on some platforms
+            file.close();
+            if (file.open(QFile::ReadWrite))
+                file.setFileTime(QDateTime::currentDateTime(),
+                    QFileDevice::FileModificationTime);
+            return true;
+        }
+#endif
+        return false;
+    }
+
+    void saveProgramBinary(GLContext &gl, GLuint program,
+        const QByteArray &key, const QStringList &infoLogs)
+    {
+#if GL_VERSION_4_1
+        if (auto gl41 = gl.v4_1) {
+            auto length = GLint{ };
+            gl.glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+            if (length <= 0)
+                return;
+
+            auto format = GLenum{ };
+            auto binary = QByteArray(length, 0);
+            gl41->glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+            const auto fileName = getProgramBinaryFileName(key);
+            QDir().mkpath(QFileInfo(fileName).path());
+            auto file = QSaveFile(fileName);
+            if (file.open(QFile::WriteOnly)) {
+                QDataStream stream(&file);
+                stream.setVersion(QDataStream::Qt_5_12);
+                stream << static_cast<quint32>(format) << infoLogs << binary;
+                if (file.commit())
+                    evictProgramBinaries(QFileInfo(fileName).path());
+            }
+        }
+#endif
+    }
+} // namespace
 
 GLProgram::GLProgram(const Program &program)
     : mItemId(program.id)
@@ -28,12 +140,10 @@ bool GLProgram::operator==(const GLProgram &rhs) const
     return (mShaders == rhs.mShaders);
 }
 
-bool GLProgram::link()
+void GLProgram::beginLink()
 {
-    if (mProgramObject)
-        return true;
-    if (mFailed)
-        return false;
+    if (mProgramObject || mPendingProgramObject || mFailed)
+        return;
 
     auto freeProgram = [](GLuint program) {
         auto &gl = GLContext::currentContext();
@@ -43,27 +153,82 @@ bool GLProgram::link()
     auto &gl = GLContext::currentContext();
     auto program = GLObject(gl.glCreateProgram(), freeProgram);
 
-    for (auto &shader : mShaders) {
-        if (!shader.compile(&mPrintf)) {
+    // sources are always patched, since printf calls are collected
+    auto patchedSources = std::vector<QStringList>();
+    for (auto &shader : mShaders)
+        patchedSources.push_back(shader.getPatchedSources(&mPrintf));
+
+    // skip compiling when binary was cached before
+    mBinaryKey = getProgramBinaryKey(gl, mShaders, patchedSources);
+    auto infoLogs = QStringList();
+    mBinaryLoaded = loadProgramBinary(gl, program, mBinaryKey,
+        static_cast<int>(mShaders.size()), &infoLogs);
+    if (mBinaryLoaded) {
+        // output the messages of the compilation, which was cached
+        for (auto i = 0u; i < mShaders.size(); ++i)
+            mShaders[i].replayLog(infoLogs[static_cast<int>(i)]);
+        GLShader::parseLog(infoLogs.last(), mLinkMessages, mItemId, { });
+    }
+    else {
+        for (auto i = 0u; i < mShaders.size(); ++i) {
+            auto &shader = mShaders[i];
+            if (!shader.beginCompile(patchedSources[i])) {
+                mFailed = true;
+                return;
+            }
+            gl.glAttachShader(program, shader.shaderObject());
+        }
+
+#if GL_VERSION_4_1
+        if (auto gl41 = gl.v4_1)
+            gl41->glProgramParameteri(program,
+                GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+        gl.glLinkProgram(program);
+    }
+    mPendingProgramObject = std::move(program);
+}
+
+bool GLProgram::link()
+{
+    if (mProgramObject)
+        return true;
+
+    beginLink();
+    if (mFailed)
+        return false;
+
+    auto &gl = GLContext::currentContext();
+    auto program = std::move(mPendingProgramObject);
+    if (!mBinaryLoaded) {
+        // query all shaders, to output all compiler messages
+        auto compiled = true;
+        for (auto &shader : mShaders)
+            compiled &= shader.finishCompile();
+        if (!compiled) {
             mFailed = true;
             return false;
         }
-        gl.glAttachShader(program, shader.shaderObject());
-    }
 
-    auto status = GLint{ };
-    gl.glLinkProgram(program);
-    gl.glGetProgramiv(program, GL_LINK_STATUS, &status);
+        auto status = GLint{ };
+        gl.glGetProgramiv(program, GL_LINK_STATUS, &status);
 
-    auto length = GLint{ };
-    gl.glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
-    auto log = std::vector<char>(static_cast<size_t>(length));
-    gl.glGetProgramInfoLog(program, length, nullptr, log.data());
-    GLShader::parseLog(log.data(), mLinkMessages, mItemId, { });
+        auto length = GLint{ };
+        gl.glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        auto log = std::vector<char>(static_cast<size_t>(length));
+        gl.glGetProgramInfoLog(program, length, nullptr, log.data());
+        GLShader::parseLog(log.data(), mLinkMessages, mItemId, { });
 
-    if (status != GL_TRUE) {
-        mFailed = true;
-        return false;
+        if (status != GL_TRUE) {
+            mFailed = true;
+            return false;
+        }
+
+        auto infoLogs = QStringList();
+        for (const auto &shader : mShaders)
+            infoLogs += shader.infoLog();
+        infoLogs += QString(log.data());
+        saveProgramBinary(gl, program, mBinaryKey, infoLogs);
     }
 
     auto buffer = std::array<char, 256>();
@@ -76,10 +241,14 @@ bool GLProgram::link()
         gl.glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()),
             &nameLength, &size, &type, buffer.data());
         const auto name = getUniformBaseName(buffer.data());
-        mActiveUniforms[name] = { type, size };
-        mUniformsSet[getUniformBaseName(name)] = false;
-        for (auto j = 0; j < size; ++j) 
-            mActiveUniforms[QStringLiteral("%1[%2]").arg(name).arg(j)] = { type, 1 };
+        mUniforms[name] = { gl.glGetUniformLocation(program, qPrintable(name)),
+            type, size, name, { } };
+        mUniformsSet[name] = false;
+        for (auto j = 0; j < size; ++j) {
+            const auto element = QStringLiteral("%1[%2]").arg(name).arg(j);
+            mUniforms[element] = { gl.glGetUniformLocation(program, qPrintable(element)),
+                type, 1, name, { } };
+        }
 
 #if GL_VERSION_4_2
         if (auto gl42 = gl.v4_2) {
@@ -237,16 +406,44 @@ void GLProgram::unbind(ItemId callItemId)
             *mCallMessages += MessageList::insert(
                 callItemId, MessageType::AttributeNotSet, kv.first);
 
-    if (mPrintf.isUsed())
+    if (mPrintf.isUsed()) {
+#if GL_VERSION_4_2
+        // make shader writes to printf buffer visible
+        if (gl.v4_2)
+            gl.v4_2->glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+#endif
         mPrintfMessages = mPrintf.formatMessages(mItemId);
+    }
 
     mCallMessages = nullptr;
 }
 
 QString GLProgram::getUniformBaseName(const QString &name) const
 {
-    const auto base = QString(name).remove(QRegularExpression("\\[.*\\]"));
-    return base;
+    // remove everything from first opening to last closing bracket
+    const auto begin = name.indexOf('[');
+    const auto end = name.lastIndexOf(']');
+    if (begin < 0 || end < begin)
+        return name;
+    return name.left(begin) + name.mid(end + 1);
+}
+
+GLProgram::Uniform *GLProgram::getUniform(const QString &name) const
+{
+    auto it = mUniforms.find(name);
+    if (it == mUniforms.end()) {
+        // names not reported by the driver (e.g. of struct members)
+        // are resolved on first use
+        auto &gl = GLContext::currentContext();
+        const auto baseName = getUniformBaseName(name);
+        const auto base = mUniforms.constFind(baseName);
+        it = mUniforms.insert(name, {
+            gl.glGetUniformLocation(mProgramObject, qPrintable(name)),
+            (base != mUniforms.constEnd() ? base->dataType : GLenum{ }),
+            (base != mUniforms.constEnd() ? base->size : GLint{ }),
+            baseName, { } });
+    }
+    return (it->location >= 0 ? &*it : nullptr);
 }
 
 void GLProgram::uniformSet(const QString &name)
@@ -267,14 +464,45 @@ void GLProgram::bufferSet(const QString &name)
 
 int GLProgram::getAttributeLocation(const QString &name) const
 {
-    if (mAttributesSet.count(name))
-        mAttributesSet[name] = true;
-    auto &gl = GLContext::currentContext();
-    return gl.glGetAttribLocation(mProgramObject, qPrintable(name));
+    auto it = mAttributesSet.find(name);
+    if (it != mAttributesSet.end())
+        it->second = true;
+
+    auto location = mAttributeLocations.find(name);
+    if (location == mAttributeLocations.end()) {
+        auto &gl = GLContext::currentContext();
+        location = mAttributeLocations.insert(name,
+            gl.glGetAttribLocation(mProgramObject, qPrintable(name)));
+    }
+    return *location;
+}
+
+bool GLProgram::hasUniform(const QString &name) const
+{
+    return (getUniform(name) != nullptr);
+}
+
+bool GLProgram::hasBufferBindingPoint(const QString &name) const
+{
+    return mBufferBindingPoints.contains(name);
+}
+
+GLenum GLProgram::getBufferBindingTarget(const QString &name) const
+{
+    return mBufferBindingPoints.value(name).first;
+}
+
+bool GLProgram::hasSubroutineUniform(const QString &name) const
+{
+    for (const auto &uniforms : mSubroutineUniforms)
+        for (const auto &uniform : uniforms)
+            if (uniform.name == name)
+                return true;
+    return false;
 }
 
 template <typename T>
-std::vector<T> getValues(const ScriptVariable &variable,
+bool updateValues(std::vector<char> &data, const ScriptVariable &variable,
     ItemId itemId, int count, MessagePtrSet &messages)
 {
     if (count != variable.count())
@@ -283,36 +511,57 @@ std::vector<T> getValues(const ScriptVariable &variable,
                 MessageType::UniformComponentMismatch,
                 QString("(%1/%2)").arg(variable.count()).arg(count));
 
-    auto result = std::vector<T>{ };
-    result.resize(count);
-    for (auto i = 0; i < std::min(count, variable.count()); ++i)
-        result[i] = variable.get(i);
-    return result;
+    // values are kept in the uniform's type, to skip setting unchanged values
+    auto changed = false;
+    const auto size = count * sizeof(T);
+    if (data.size() != size) {
+        data.resize(size);
+        changed = true;
+    }
+    auto values = reinterpret_cast<T*>(data.data());
+    for (auto i = 0; i < count; ++i) {
+        const auto value = static_cast<T>(variable.get(i));
+        if (changed || values[i] != value) {
+            values[i] = value;
+            changed = true;
+        }
+    }
+    return changed;
 }
 
 bool GLProgram::apply(const GLUniformBinding &binding)
 {
-    auto &gl = GLContext::currentContext();
-    const auto location = gl.glGetUniformLocation(
-        mProgramObject, qPrintable(binding.name));
-    if (location < 0)
+    auto uniform = getUniform(binding.name);
+    if (!uniform)
         return false;
 
-    const auto [dataType, size] = 
-        mActiveUniforms[(mActiveUniforms.contains(binding.name) ? 
-           binding.name : getUniformBaseName(binding.name))];
+    auto &gl = GLContext::currentContext();
+    const auto location = uniform->location;
+    const auto dataType = uniform->dataType;
+    const auto size = uniform->size;
     Q_ASSERT(dataType);
 
+    auto written = false;
     switch (dataType) {
 #define ADD(TYPE, DATATYPE, COUNT, FUNCTION) \
-        case TYPE: FUNCTION(location, size, \
-                getValues<DATATYPE>(binding.values, binding.bindingItemId, \
-                    COUNT * size, *mCallMessages).data()); break
+        case TYPE: \
+            if (updateValues<DATATYPE>(uniform->values, binding.values, \
+                    binding.bindingItemId, COUNT * size, *mCallMessages)) { \
+                FUNCTION(location, size, \
+                    reinterpret_cast<const DATATYPE*>(uniform->values.data())); \
+                written = true; \
+            } \
+            break
 
 #define ADD_MATRIX(TYPE, DATATYPE, COUNT, FUNCTION) \
-        case TYPE: FUNCTION(location, size, binding.transpose, \
-                getValues<DATATYPE>(binding.values, binding.bindingItemId, \
-                    COUNT * size, *mCallMessages).data()); break
+        case TYPE: \
+            if (updateValues<DATATYPE>(uniform->values, binding.values, \
+                    binding.bindingItemId, COUNT * size, *mCallMessages)) { \
+                FUNCTION(location, size, binding.transpose, \
+                    reinterpret_cast<const DATATYPE*>(uniform->values.data())); \
+                written = true; \
+            } \
+            break
 
         ADD(GL_FLOAT, GLfloat, 1, gl.glUniform1fv);
         ADD(GL_FLOAT_VEC2, GLfloat, 2, gl.glUniform2fv);
@@ -356,17 +605,25 @@ bool GLProgram::apply(const GLUniformBinding &binding)
 #undef ADD_MATRIX
     }
 
-    uniformSet(getUniformBaseName(binding.name));
+    // an array and its elements share locations, so their values are not
+    // known anymore when one of them was written
+    if (written)
+        for (auto it = mUniforms.begin(); it != mUniforms.end(); ++it)
+            if (&*it != uniform && it->baseName == uniform->baseName)
+                it->values.clear();
+
+    uniformSet(uniform->baseName);
     return true;
 }
 
 bool GLProgram::apply(const GLSamplerBinding &binding, int unit)
 {
-    auto &gl = GLContext::currentContext();
-    const auto location = gl.glGetUniformLocation(
-        mProgramObject, qPrintable(binding.name));
-    if (location < 0)
+    const auto uniform = getUniform(binding.name);
+    if (!uniform)
         return false;
+    const auto location = uniform->location;
+
+    auto &gl = GLContext::currentContext();
     if (!binding.texture)
         return false;
 
@@ -423,11 +680,12 @@ bool GLProgram::apply(const GLSamplerBinding &binding, int unit)
 
 bool GLProgram::apply(const GLImageBinding &binding, int unit)
 {
-    auto &gl = GLContext::currentContext();
-    const auto location = gl.glGetUniformLocation(
-        mProgramObject, qPrintable(binding.name));
-    if (location < 0)
+    const auto uniform = getUniform(binding.name);
+    if (!uniform)
         return false;
+    const auto location = uniform->location;
+
+    auto &gl = GLContext::currentContext();
 
     if (!gl.v4_2)
         return false;
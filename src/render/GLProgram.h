@@ -67,10 +67,15 @@ public:
     explicit GLProgram(const Program &program);
     bool operator==(const GLProgram &rhs) const;
 
+    void beginLink();
     bool link();
     bool bind(MessagePtrSet *callMessages);
     void unbind(ItemId callItemId);
     int getAttributeLocation(const QString &name) const;
+    bool hasUniform(const QString &name) const;
+    bool hasBufferBindingPoint(const QString &name) const;
+    GLenum getBufferBindingTarget(const QString &name) const;
+    bool hasSubroutineUniform(const QString &name) const;
     bool apply(const GLUniformBinding &binding);
     bool apply(const GLSamplerBinding &binding, int unit);
     bool apply(const GLImageBinding &binding, int unit);
@@ -90,7 +95,17 @@ private:
         QString boundSubroutine;
     };
 
+    struct Uniform
+    {
+        GLint location;
+        GLenum dataType;
+        GLint size;
+        QString baseName;
+        std::vector<char> values;
+    };
+
     QString getUniformBaseName(const QString &name) const;
+    Uniform *getUniform(const QString &name) const;
     void uniformSet(const QString &name);
     void bufferSet(const QString &name);
 
@@ -99,15 +114,19 @@ private:
     MessagePtrSet mLinkMessages;
     std::vector<GLShader> mShaders;
     QMap<Shader::ShaderType, QList<SubroutineUniform>> mSubroutineUniforms;
-    QMap<QString, std::pair<GLenum, GLint>> mActiveUniforms;
+    mutable QHash<QString, Uniform> mUniforms;
     QMap<QString, std::pair<GLenum, GLint>> mBufferBindingPoints;
     QMap<QString, GLObject> mTextureBufferObjects;
     GLObject mProgramObject;
+    GLObject mPendingProgramObject;
+    QByteArray mBinaryKey;
+    bool mBinaryLoaded{ };
     bool mFailed{ };
     MessagePtrSet *mCallMessages{ };
     std::map<QString, bool> mUniformsSet;
     std::map<QString, bool> mBuffersSet;
     mutable std::map<QString, bool> mAttributesSet;
+    mutable QHash<QString, GLint> mAttributeLocations;
     GLPrintf mPrintf;
     MessagePtrSet mPrintfMessages;
 };
@@ -137,6 +137,19 @@ QString GLShader::getSource() const
 }
 
 bool GLShader::compile(GLPrintf* printf, bool silent)
+{
+    if (mShaderObject)
+        return finishCompile(silent);
+
+    return compile(getPatchedSources(printf), silent);
+}
+
+bool GLShader::compile(const QStringList &patchedSources, bool silent)
+{
+    return (beginCompile(patchedSources) && finishCompile(silent));
+}
+
+bool GLShader::beginCompile(const QStringList &patchedSources)
 {
     if (!GLContext::currentContext()) {
         mMessages += MessageList::insert(
@@ -161,7 +174,7 @@ bool GLShader::compile(GLPrintf* printf, bool silent)
     }
 
     auto sources = std::vector<std::string>();
-    for (const QString &source : getPatchedSources(printf))
+    for (const QString &source : patchedSources)
         sources.push_back(source.toUtf8().data());
 
     auto sourcePointers = std::vector<const char*>();
@@ -170,25 +183,45 @@ bool GLShader::compile(GLPrintf* printf, bool silent)
     gl.glShaderSource(shader, static_cast<GLsizei>(sourcePointers.size()),
         sourcePointers.data(), nullptr);
 
+    // status is not queried before finishCompile,
+    // so the driver can compile multiple shaders in parallel
     gl.glCompileShader(shader);
 
+    mShaderObject = std::move(shader);
+    mCompilePending = true;
+    return true;
+}
+
+bool GLShader::finishCompile(bool silent)
+{
+    if (!std::exchange(mCompilePending, false))
+        return static_cast<bool>(mShaderObject);
+
+    auto &gl = GLContext::currentContext();
     auto status = GLint{ };
-    gl.glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    gl.glGetShaderiv(mShaderObject, GL_COMPILE_STATUS, &status);
 
     if (!silent) {
         auto length = GLint{ };
-        gl.glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        gl.glGetShaderiv(mShaderObject, GL_INFO_LOG_LENGTH, &length);
         auto log = std::vector<char>(static_cast<size_t>(length));
-        gl.glGetShaderInfoLog(shader, length, nullptr, log.data());
-        GLShader::parseLog(log.data(), mMessages, mItemId, mFileNames);
+        gl.glGetShaderInfoLog(mShaderObject, length, nullptr, log.data());
+        mInfoLog = log.data();
+        GLShader::parseLog(mInfoLog, mMessages, mItemId, mFileNames);
     }
-    if (status != GL_TRUE)
+    if (status != GL_TRUE) {
+        mShaderObject.reset();
         return false;
-
-    mShaderObject = std::move(shader);
+    }
     return true;
 }
 
+void GLShader::replayLog(const QString &log)
+{
+    mInfoLog = log;
+    GLShader::parseLog(mInfoLog, mMessages, mItemId, mFileNames);
+}
+
 QStringList GLShader::getPatchedSources(GLPrintf *printf)
 {
     Q_ASSERT(!mSources.isEmpty());
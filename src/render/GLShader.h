@@ -17,20 +17,26 @@ public:
     Shader::ShaderType type() const { return mType; }
 
     QString getSource() const;
+    QStringList getPatchedSources(GLPrintf *printf);
     bool compile(GLPrintf *printf = nullptr, bool silent = false);
+    bool compile(const QStringList &patchedSources, bool silent = false);
+    bool beginCompile(const QStringList &patchedSources);
+    bool finishCompile(bool silent = false);
+    void replayLog(const QString &log);
+    const QString &infoLog() const { return mInfoLog; }
     GLuint shaderObject() const { return mShaderObject; }
     QString getAssembly();
 
 private:
-    QStringList getPatchedSources(GLPrintf *printf);
-
     ItemId mItemId{ };
     MessagePtrSet mMessages;
     QStringList mFileNames;
     QStringList mSources;
     QStringList mIncludableSources;
+    QString mInfoLog;
     Shader::ShaderType mType;
     GLObject mShaderObject;
+    bool mCompilePending{ };
 };
 
 #endif // GLSHADER_H
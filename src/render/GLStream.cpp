@@ -1,4 +1,5 @@
 #include "GLStream.h"
+#include "GLHazardTracker.h"
 
 GLStream::GLStream(const Stream &stream)
 {
@@ -56,6 +57,58 @@ bool GLStream::validateAttribute(const GLAttribute &attribute) const
 }
 
 void GLStream::bind(const GLProgram &program)
+{
+    // vertex array objects are kept per program,
+    // they are only set up again when a buffer object changed
+    auto &vertexArray = mVertexArrays[&program];
+    auto valid = static_cast<bool>(vertexArray.vertexArrayObject);
+    auto index = size_t{ };
+    for (const GLAttribute &attribute : qAsConst(mAttributes)) {
+        if (program.getAttributeLocation(attribute.name) < 0 ||
+            !attribute.buffer)
+            continue;
+
+        // also uploads modified buffer data
+        const auto bufferObject = attribute.buffer->getReadOnlyBufferId();
+        if (index == vertexArray.bufferObjects.size()) {
+            vertexArray.bufferObjects.push_back(bufferObject);
+            valid = false;
+        }
+        else if (vertexArray.bufferObjects[index] != bufferObject) {
+            vertexArray.bufferObjects[index] = bufferObject;
+            valid = false;
+        }
+        ++index;
+    }
+
+    auto &gl = GLContext::currentContext();
+    if (valid) {
+        gl.glBindVertexArray(vertexArray.vertexArrayObject);
+        return;
+    }
+
+    auto createVertexArray = [&]() {
+        auto object = GLuint{ };
+        gl.glGenVertexArrays(1, &object);
+        return object;
+    };
+    auto freeVertexArray = [](GLuint object) {
+        auto &gl = GLContext::currentContext();
+        gl.glDeleteVertexArrays(1, &object);
+    };
+    vertexArray.vertexArrayObject = GLObject(createVertexArray(), freeVertexArray);
+    gl.glBindVertexArray(vertexArray.vertexArrayObject);
+    setupVertexArray(program);
+}
+
+void GLStream::trackResources(GLHazardTracker &tracker) const
+{
+    for (const GLAttribute &attribute : qAsConst(mAttributes))
+        tracker.read(attribute.buffer,
+            GLHazardTracker::Access::VertexAttribute);
+}
+
+void GLStream::setupVertexArray(const GLProgram &program)
 {
     auto &gl = GLContext::currentContext();
     for (const GLAttribute &attribute : qAsConst(mAttributes)) {
@@ -4,6 +4,8 @@
 #include "GLProgram.h"
 #include "GLBuffer.h"
 
+class GLHazardTracker;
+
 class GLStream
 {
 public:
@@ -13,6 +15,7 @@ public:
         ScriptEngine& scriptEngine);
 
     void bind(const GLProgram &program);
+    void trackResources(GLHazardTracker &tracker) const;
     const QSet<ItemId> &usedItems() const { return mUsedItems; }
 
 private:
@@ -29,11 +32,19 @@ private:
         int offset;
     };
 
+    struct GLVertexArray
+    {
+        std::vector<GLuint> bufferObjects;
+        GLObject vertexArrayObject;
+    };
+
     bool validateAttribute(const GLAttribute &attribute) const;
+    void setupVertexArray(const GLProgram &program);
 
     MessagePtrSet mMessages;
     QSet<ItemId> mUsedItems;
     QMap<int, GLAttribute> mAttributes;
+    std::map<const GLProgram*, GLVertexArray> mVertexArrays;
 };
 
 #endif // GL_STREAM_H
@@ -1,4 +1,5 @@
 #include "GLTarget.h"
+#include "GLHazardTracker.h"
 
 GLTarget::GLTarget(const Target &target)
     : mItemId(target.id)
@@ -59,6 +60,13 @@ void GLTarget::unbind()
     gl.glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
 }
 
+void GLTarget::trackResources(GLHazardTracker &tracker) const
+{
+    for (const auto &attachment : mAttachments)
+        tracker.read(attachment.texture,
+            GLHazardTracker::Access::Framebuffer);
+}
+
 bool GLTarget::create()
 {
     if (mFramebufferObject)
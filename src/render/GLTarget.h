@@ -3,6 +3,8 @@
 
 #include "GLTexture.h"
 
+class GLHazardTracker;
+
 class GLTarget
 {
 public:
@@ -11,6 +13,7 @@ public:
 
     bool bind();
     void unbind();
+    void trackResources(GLHazardTracker &tracker) const;
     const QSet<ItemId> &usedItems() const { return mUsedItems; }
 
 private:
@@ -3,6 +3,8 @@
 #include "scripting/ScriptEngine.h"
 #include <QOpenGLPixelTransferOptions>
 #include <cmath>
+#include <cstring>
+#include <utility>
 
 GLTexture::GLTexture(const Texture &texture, ScriptEngine &scriptEngine)
     : mItemId(texture.id)
@@ -205,7 +207,7 @@ void GLTexture::reload(bool forWriting)
 
     auto fileData = TextureData{ };
     if (!FileDialog::isEmptyOrUntitled(mFileName))
-        if (!Singletons::fileCache().getTexture(mFileName, mFlipVertically, &fileData))
+        if (!Singletons::fileCache().getTexture(mFileName, &fileData))
             mMessages += MessageList::insert(mItemId,
                 MessageType::LoadingFileFailed, mFileName);
 
@@ -233,6 +235,7 @@ void GLTexture::reload(bool forWriting)
                 MessageType::CreatingTextureFailed);
         }
         mData.clear();
+        mData.setFlippedVertically(mFlipVertically);
         mSystemCopyModified |= true;
     }
 }
@@ -268,11 +271,29 @@ void GLTexture::upload()
     if (!mSystemCopyModified)
         return;
 
-    if (!mData.upload(mTextureObject, mFormat)) {
-        mMessages += MessageList::insert(
-            mItemId, MessageType::UploadingImageFailed);
+    // data in other orientation is flipped on upload and
+    // completely uploaded again, when it is modified
+    if (mData.flippedVertically() != mFlipVertically) {
+        if (!uploadFlipped()) {
+            mMessages += MessageList::insert(
+                mItemId, MessageType::UploadingImageFailed);
+            return;
+        }
+        mUploadedData = { };
+        mSystemCopyModified = mDeviceCopyModified = false;
         return;
     }
+
+    // only upload regions which differ from device copy
+    if (mDeviceCopyModified ||
+        !mData.uploadModified(mTextureObject, mUploadedData, mFormat)) {
+        if (!mData.upload(mTextureObject, mFormat)) {
+            mMessages += MessageList::insert(
+                mItemId, MessageType::UploadingImageFailed);
+            return;
+        }
+    }
+    mUploadedData = mData;
     mSystemCopyModified = mDeviceCopyModified = false;
 }
 
@@ -289,6 +310,94 @@ bool GLTexture::download()
             mItemId, MessageType::DownloadingImageFailed);
         return false;
     }
+    mData.setFlippedVertically(mFlipVertically);
+    mUploadedData = mData;
+    mSystemCopyModified = mDeviceCopyModified = false;
+    return true;
+}
+
+bool GLTexture::beginDownload()
+{
+    if (mTextureBuffer)
+        return mTextureBuffer->beginDownload();
+
+    if (!mDeviceCopyModified)
+        return false;
+
+    // other textures are downloaded synchronously by finishDownload
+    if (mData.isNull() || mData.isMultisample() ||
+        mData.isCubemap() || mData.isCompressed())
+        return true;
+
+    auto size = 0;
+    for (auto level = 0; level < mData.levels(); ++level)
+        size += mData.getLevelSize(level);
+
+    auto &gl = GLContext::currentContext();
+    if (!mPackBuffer || mPackBufferSize != size) {
+        auto createBuffer = [&]() {
+            auto buffer = GLuint{ };
+            gl.glGenBuffers(1, &buffer);
+            return buffer;
+        };
+        auto freeBuffer = [](GLuint buffer) {
+            auto &gl = GLContext::currentContext();
+            gl.glDeleteBuffers(1, &buffer);
+        };
+        mPackBuffer = GLObject(createBuffer(), freeBuffer);
+        mPackBufferSize = size;
+        gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, mPackBuffer);
+        gl.glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    }
+    else {
+        gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, mPackBuffer);
+    }
+
+    gl.glBindTexture(mTarget, mTextureObject);
+    auto offset = intptr_t{ };
+    for (auto level = 0; level < mData.levels(); ++level) {
+        gl.glGetTexImage(mTarget, level, mData.pixelFormat(),
+            mData.pixelType(), reinterpret_cast<void*>(offset));
+        offset += mData.getLevelSize(level);
+    }
+    gl.glBindTexture(mTarget, GL_NONE);
+    gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
+
+    mDownloadPending = true;
+    return true;
+}
+
+bool GLTexture::finishDownload()
+{
+    if (mTextureBuffer)
+        return mTextureBuffer->finishDownload();
+
+    if (!std::exchange(mDownloadPending, false))
+        return download();
+
+    auto &gl = GLContext::currentContext();
+    gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, mPackBuffer);
+    const auto data = static_cast<const uchar*>(gl.glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, mPackBufferSize, GL_MAP_READ_BIT));
+    if (data) {
+        auto offset = 0;
+        for (auto level = 0; level < mData.levels(); ++level) {
+            const auto levelSize = mData.getLevelSize(level);
+            std::memcpy(mData.getWriteonlyData(level, 0, 0),
+                data + offset, levelSize);
+            offset += levelSize;
+        }
+        gl.glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
+
+    if (!data) {
+        mMessages += MessageList::insert(
+            mItemId, MessageType::DownloadingImageFailed);
+        return false;
+    }
+    mData.setFlippedVertically(mFlipVertically);
+    mUploadedData = mData;
     mSystemCopyModified = mDeviceCopyModified = false;
     return true;
 }
@@ -323,8 +432,49 @@ GLObject GLTexture::createFramebuffer(GLuint textureId, int level) const
     return fbo;
 }
 
+bool GLTexture::uploadFlipped()
+{
+    const auto uploadFlippedCopy = [&]() {
+        auto data = mData;
+        return (data.flipVertically() && data.upload(mTextureObject, mFormat));
+    };
+
+    // only uncompressed 2D textures can be flipped by a blit
+    if (mTarget != QOpenGLTexture::Target2D || mData.isCompressed())
+        return uploadFlippedCopy();
+
+    auto &gl = GLContext::currentContext();
+    const auto freeTexture = [](GLuint texture) {
+        auto &gl = GLContext::currentContext();
+        gl.glDeleteTextures(1, &texture);
+    };
+    auto stagingTextureId = GLuint{ };
+    if (!mData.upload(&stagingTextureId, mFormat)) {
+        gl.glDeleteTextures(1, &stagingTextureId);
+        return false;
+    }
+    const auto stagingTexture = GLObject(stagingTextureId, freeTexture);
+
+    // allocate storage, pixel format and type need to be valid for format
+    auto formatData = TextureData();
+    if (!formatData.create(mTarget, mFormat, 1, 1))
+        return false;
+    gl.glBindTexture(mTarget, mTextureObject);
+    for (auto level = 0; level < mData.levels(); ++level)
+        gl.glTexImage2D(mTarget, level, mFormat,
+            mData.getLevelWidth(level), mData.getLevelHeight(level), 0,
+            formatData.pixelFormat(), formatData.pixelType(), nullptr);
+    gl.glTexParameteri(mTarget, GL_TEXTURE_MAX_LEVEL, mData.levels() - 1);
+    gl.glBindTexture(mTarget, GL_NONE);
+
+    for (auto level = 0; level < mData.levels(); ++level)
+        if (!copyTexture(stagingTexture, mTextureObject, level, true))
+            return uploadFlippedCopy();
+    return true;
+}
+
 bool GLTexture::copyTexture(GLuint sourceTextureId,
-    GLuint destTextureId, int level)
+    GLuint destTextureId, int level, bool flipVertically)
 {
     auto &gl = GLContext::currentContext();
     const auto sourceFbo = createFramebuffer(sourceTextureId, level);
@@ -344,7 +494,8 @@ bool GLTexture::copyTexture(GLuint sourceTextureId,
 
     gl.glBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFbo);
     gl.glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destFbo);
-    gl.glBlitFramebuffer(0, 0, width, height, 0, 0,
-        width, height, blitMask, GL_NEAREST);
+    gl.glBlitFramebuffer(0, 0, width, height,
+        0, (flipVertically ? height : 0),
+        width, (flipVertically ? 0 : height), blitMask, GL_NEAREST);
     return true;
 }
@@ -26,6 +26,7 @@ public:
     Texture::Format format() const { return mFormat; }
     TextureData data() const { return mData; }
     GLuint textureId() const { return mTextureObject; }
+    const GLBuffer *textureBuffer() const { return mTextureBuffer; }
     const QSet<ItemId> &usedItems() const { return mUsedItems; }
 
     bool clear(std::array<double, 4> color, double depth, int stencil);
@@ -35,14 +36,17 @@ public:
     GLuint getReadWriteTextureId();
     bool deviceCopyModified() const { return mDeviceCopyModified; }
     bool download();
+    bool beginDownload();
+    bool finishDownload();
 
 private:
     GLObject createFramebuffer(GLuint textureId, int level) const;
     void reload(bool forWriting);
     void createTexture();
     void upload();
+    bool uploadFlipped();
     bool copyTexture(GLuint sourceTextureId,
-        GLuint destTextureId, int level);
+        GLuint destTextureId, int level, bool flipVertically = false);
 
     ItemId mItemId{ };
     MessagePtrSet mMessages;
@@ -57,9 +61,13 @@ private:
     int mLayers{ };
     int mSamples{ };
     TextureData mData;
+    TextureData mUploadedData;
     QSet<ItemId> mUsedItems;
     TextureKind mKind{ };
     GLObject mTextureObject;
+    GLObject mPackBuffer;
+    int mPackBufferSize{ };
+    bool mDownloadPending{ };
     bool mSystemCopyModified{ };
     bool mDeviceCopyModified{ };
     bool mMipmapsInvalidated{ };
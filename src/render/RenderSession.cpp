@@ -16,71 +16,227 @@
 #include "GLStream.h"
 #include "GLCall.h"
 #include "GLShareSynchronizer.h"
-#include <functional>
-#include <deque>
-#include <QStack>
+#include "GLHazardTracker.h"
+#include "Settings.h"
 #include <QOpenGLTimerQuery>
 #include <type_traits>
+#include <utility>
 
 namespace {
-    struct BindingScope
+    enum class BindingKind { Uniform, Sampler, Image, Buffer, Subroutine };
+
+    // slots of the bindings a program uses, sorted by name
+    struct ProgramSlots
     {
-        std::map<QString, GLUniformBinding> uniforms;
-        std::map<QString, GLSamplerBinding> samplers;
-        std::map<QString, GLImageBinding> images;
-        std::map<QString, GLBufferBinding> buffers;
-        std::map<QString, GLSubroutineBinding> subroutines;
+        std::vector<int> uniforms;
+        std::vector<int> samplers;
+        std::vector<int> images;
+        std::vector<int> buffers;
+        std::vector<int> subroutines;
     };
-    using BindingState = QStack<BindingScope>;
-    using Command = std::function<void(BindingState&)>;
 
-    QSet<ItemId> applyBindings(BindingState &state, GLProgram &program)
+    // binding names are interned to one slot per kind and name
+    struct Bindings
     {
-        QSet<ItemId> usedItems;
-        BindingScope bindings;
-        for (const BindingScope &scope : state) {
-            for (const auto &kv : scope.uniforms)
-                bindings.uniforms[kv.first] = kv.second;
-            for (const auto &kv : scope.samplers)
-                bindings.samplers[kv.first] = kv.second;
-            for (const auto &kv : scope.images)
-                bindings.images[kv.first] = kv.second;
-            for (const auto &kv : scope.buffers)
-                bindings.buffers[kv.first] = kv.second;
-            for (const auto &kv : scope.subroutines)
-                bindings.subroutines[kv.first] = kv.second;
+        std::map<std::pair<BindingKind, QString>, int> slots;
+        std::vector<GLUniformBinding> uniforms;
+        std::vector<GLSamplerBinding> samplers;
+        std::vector<GLImageBinding> images;
+        std::vector<GLBufferBinding> buffers;
+        std::vector<GLSubroutineBinding> subroutines;
+        std::map<const GLProgram*, ProgramSlots> programSlots;
+
+        int getSlot(BindingKind kind, const QString &name)
+        {
+            return slots.emplace(std::make_pair(kind, name),
+                static_cast<int>(slots.size())).first->second;
+        }
+
+        const ProgramSlots &getProgramSlots(const GLProgram &program)
+        {
+            auto it = programSlots.find(&program);
+            if (it != programSlots.end())
+                return it->second;
+
+            auto &result = programSlots[&program];
+            for (const auto &[key, slot] : slots) {
+                const auto &[kind, name] = key;
+                switch (kind) {
+                    case BindingKind::Uniform:
+                        if (program.hasUniform(name))
+                            result.uniforms.push_back(slot);
+                        break;
+                    case BindingKind::Sampler:
+                        if (program.hasUniform(name))
+                            result.samplers.push_back(slot);
+                        break;
+                    case BindingKind::Image:
+                        if (program.hasUniform(name))
+                            result.images.push_back(slot);
+                        break;
+                    case BindingKind::Buffer:
+                        if (program.hasBufferBindingPoint(name))
+                            result.buffers.push_back(slot);
+                        break;
+                    case BindingKind::Subroutine:
+                        if (program.hasSubroutineUniform(name))
+                            result.subroutines.push_back(slot);
+                        break;
+                }
+            }
+            return result;
         }
+    };
 
-        for (const auto &kv : bindings.uniforms)
-            if (program.apply(kv.second))
-                usedItems += kv.second.bindingItemId;
+    // binding index per slot, leaving a scope restores the previous ones
+    class BindingState
+    {
+    public:
+        explicit BindingState(size_t slotCount)
+            : mIndices(slotCount, -1)
+            , mScopes(slotCount, -1)
+        {
+        }
+
+        int operator[](int slot) const { return mIndices[slot]; }
+
+        void pushScope()
+        {
+            mScopeBegins.push_back(mUndoLog.size());
+        }
+
+        void popScope()
+        {
+            Q_ASSERT(!mScopeBegins.empty());
+            const auto begin = mScopeBegins.back();
+            mScopeBegins.pop_back();
+            while (mUndoLog.size() > begin) {
+                const auto &undo = mUndoLog.back();
+                mIndices[undo.slot] = undo.index;
+                mScopes[undo.slot] = undo.scope;
+                mUndoLog.pop_back();
+            }
+        }
+
+        void set(int slot, int index)
+        {
+            // only the first change within a scope needs to be undone
+            const auto scope = static_cast<int>(mScopeBegins.size());
+            if (mScopes[slot] != scope) {
+                mUndoLog.push_back({ slot, mIndices[slot], mScopes[slot] });
+                mScopes[slot] = scope;
+            }
+            mIndices[slot] = index;
+        }
+
+    private:
+        struct Undo
+        {
+            int slot;
+            int index;
+            int scope;
+        };
+
+        std::vector<int> mIndices;
+        std::vector<int> mScopes;
+        std::vector<Undo> mUndoLog;
+        std::vector<size_t> mScopeBegins;
+    };
+
+    struct Command
+    {
+        enum class Type { PushScope, PopScope, SetBinding,
+                          BeginLoop, EndLoop, ExecuteCall };
+        Type type;
+        int index;      // binding, loop or call
+        int operand;    // slot of binding, begin of loop
+    };
+
+    struct CallCommand
+    {
+        Call::ExecuteOn executeOn;
+        GLCall call;
+    };
+
+    void trackBindings(const BindingState &state,
+        Bindings &bindings, const GLProgram &program, GLHazardTracker &tracker)
+    {
+        using Access = GLHazardTracker::Access;
+        const auto &slots = bindings.getProgramSlots(program);
+
+        for (auto slot : slots.samplers)
+            if (const auto index = state[slot]; index >= 0) {
+                // mipmaps may be generated before sampling
+                const auto &binding = bindings.samplers[index];
+                tracker.read(binding.texture, Access::TextureFetch);
+                tracker.read(binding.texture, Access::TextureUpdate);
+            }
+
+        for (auto slot : slots.images)
+            if (const auto index = state[slot]; index >= 0)
+                tracker.write(bindings.images[index].texture,
+                    Access::ShaderImage);
+
+        for (auto slot : slots.buffers)
+            if (const auto index = state[slot]; index >= 0) {
+                const auto &binding = bindings.buffers[index];
+                tracker.bindBuffer(binding.buffer,
+                    program.getBufferBindingTarget(binding.name),
+                    binding.readonly);
+            }
+    }
+
+    QSet<ItemId> applyBindings(const BindingState &state,
+        Bindings &bindings, GLProgram &program)
+    {
+        QSet<ItemId> usedItems;
+        const auto &slots = bindings.getProgramSlots(program);
+
+        for (auto slot : slots.uniforms)
+            if (const auto index = state[slot]; index >= 0) {
+                const auto &binding = bindings.uniforms[index];
+                if (program.apply(binding))
+                    usedItems += binding.bindingItemId;
+            }
 
         auto unit = 0;
-        for (const auto &kv : bindings.samplers)
-            if (program.apply(kv.second, unit)) {
-                ++unit;
-                usedItems += kv.second.bindingItemId;
-                usedItems += kv.second.texture->usedItems();
+        for (auto slot : slots.samplers)
+            if (const auto index = state[slot]; index >= 0) {
+                const auto &binding = bindings.samplers[index];
+                if (program.apply(binding, unit)) {
+                    ++unit;
+                    usedItems += binding.bindingItemId;
+                    usedItems += binding.texture->usedItems();
+                }
             }
 
-        for (const auto &kv : bindings.images)
-            if (program.apply(kv.second, unit)) {
-                ++unit;
-                usedItems += kv.second.bindingItemId;
-                usedItems += kv.second.texture->usedItems();
+        for (auto slot : slots.images)
+            if (const auto index = state[slot]; index >= 0) {
+                const auto &binding = bindings.images[index];
+                if (program.apply(binding, unit)) {
+                    ++unit;
+                    usedItems += binding.bindingItemId;
+                    usedItems += binding.texture->usedItems();
+                }
             }
 
-        for (const auto &kv : bindings.buffers)
-            if (program.apply(kv.second)) {
-                usedItems += kv.second.bindingItemId;
-                usedItems += kv.second.buffer->usedItems();
+        for (auto slot : slots.buffers)
+            if (const auto index = state[slot]; index >= 0) {
+                const auto &binding = bindings.buffers[index];
+                if (program.apply(binding)) {
+                    usedItems += binding.bindingItemId;
+                    usedItems += binding.buffer->usedItems();
+                }
             }
 
         program.applyPrintfBindings();
 
-        for (const auto &kv : bindings.subroutines)
-            if (program.apply(kv.second))
-                usedItems += kv.second.bindingItemId;
+        for (auto slot : slots.subroutines)
+            if (const auto index = state[slot]; index >= 0) {
+                const auto &binding = bindings.subroutines[index];
+                if (program.apply(binding))
+                    usedItems += binding.bindingItemId;
+            }
         program.reapplySubroutines();
 
         return usedItems;
@@ -100,6 +256,27 @@ namespace {
                 std::forward<Args>(args)...)).first->second;
     }
 
+    // moves an unmodified resource from the previous queue,
+    // the map node is transferred, so its address does not change
+    template<typename T, typename IsUnmodified>
+    void reuseUnmodified(std::map<ItemId, T> &to, std::map<ItemId, T> &from,
+        ItemId id, const QSet<ItemId> &invalidated, IsUnmodified &&isUnmodified)
+    {
+        if (invalidated.contains(id) || to.count(id))
+            return;
+        // resources which are not reused are released with the previous queue
+        auto it = from.find(id);
+        if (it != from.end() && isUnmodified(it->second))
+            to.insert(from.extract(it));
+    }
+
+    template<typename T>
+    void reuseUnmodified(std::map<ItemId, T> &to, std::map<ItemId, T> &from,
+        ItemId id, const QSet<ItemId> &invalidated)
+    {
+        reuseUnmodified(to, from, id, invalidated, [](const T &) { return true; });
+    }
+
     template<typename T>
     void replaceEqual(std::map<ItemId, T> &to, std::map<ItemId, T> &from)
     {
@@ -157,13 +334,38 @@ struct RenderSession::CommandQueue
     std::map<ItemId, GLProgram> programs;
     std::map<ItemId, GLTarget> targets;
     std::map<ItemId, GLStream> vertexStreams;
-    std::deque<Command> commands;
+    std::vector<Command> commands;
+    std::vector<CallCommand> calls;
+    std::vector<int> loopIterations;
+    Bindings bindings;
     std::vector<GLProgram> failedPrograms;
+    QHash<ItemId, QSet<ItemId>> dependentResources;
+    std::vector<GLTexture*> downloadingTextures;
+    std::vector<GLBuffer*> downloadingBuffers;
+    GLsync downloadFence{ };
 };
 
 RenderSession::RenderSession(QObject *parent)
     : RenderTask(parent)
 {
+    auto &session = Singletons::sessionModel();
+    connect(&session, &QAbstractItemModel::dataChanged, this,
+        [this](const QModelIndex &topLeft, const QModelIndex &,
+               const QVector<int> &roles) {
+            // ignore ForegroundRole...
+            if (roles.empty())
+                handleItemModified(topLeft);
+        });
+    connect(&session, &QAbstractItemModel::rowsInserted,
+        this, &RenderSession::handleRowsModified);
+    connect(&session, &QAbstractItemModel::rowsAboutToBeRemoved,
+        this, &RenderSession::handleRowsModified);
+    connect(&session, &QAbstractItemModel::rowsMoved,
+        this, [this]() { mAllItemsModified = true; });
+    connect(&session, &QAbstractItemModel::modelReset,
+        this, [this]() { mAllItemsModified = true; });
+    connect(&session, &QAbstractItemModel::layoutChanged,
+        this, [this]() { mAllItemsModified = true; });
 }
 
 RenderSession::~RenderSession()
@@ -177,11 +379,35 @@ QSet<ItemId> RenderSession::usedItems() const
     return mUsedItemsCopy;
 }
 
+void RenderSession::handleItemModified(const QModelIndex &index)
+{
+    // rows inserted/removed on top level do not affect existing resources
+    if (!index.isValid())
+        return;
+
+    // scripts can change what all resources evaluate to
+    const auto &session = Singletons::sessionModel();
+    if (session.item<Script>(index))
+        mAllItemsModified = true;
+
+    mModifiedItems += session.getItemId(index);
+}
+
+void RenderSession::handleRowsModified(const QModelIndex &parent,
+    int first, int last)
+{
+    const auto &session = Singletons::sessionModel();
+    for (auto row = first; row <= last; ++row)
+        handleItemModified(session.index(row, 0, parent));
+    handleItemModified(parent);
+}
+
 void RenderSession::prepare(bool itemsChanged,
         EvaluationType evaluationType)
 {
     mItemsChanged = itemsChanged;
     mEvaluationType = evaluationType;
+    mTrackMemoryBarriers = Singletons::settings().trackMemoryBarriers();
 
     if (!mCommandQueue)
         mEvaluationType = EvaluationType::Reset;
@@ -195,29 +421,15 @@ void RenderSession::prepare(bool itemsChanged,
         mScriptEngine->setGlobal("input", mInputScriptObject);
     }
 
-    mInputScriptObject->setMouseFragCoord(Singletons::synchronizeLogic().mousePosition());
-
-    const auto evaluateScript = [&](const Script &script) {
-        if (shouldExecute(script.executeOn, mEvaluationType)) {
-            auto source = QString();
-            if (Singletons::fileCache().getSource(script.fileName, &source))
-                mScriptEngine->evaluateScript(source, script.fileName, mMessages);
-        }
-    };
-
-    const auto &session = Singletons::sessionModel();
+    updateMousePosition();
 
     if (!itemsChanged && mEvaluationType != EvaluationType::Reset) {
-        mScriptEngine->updateVariables(mMessages);
-
-        session.forEachItem([&](const Item &item) {
-            if (auto script = castItem<Script>(item))
-                evaluateScript(*script);
-        });
-        mGpupadScriptObject->applySessionUpdate(*mScriptEngine);
+        reevaluateScripts(mMessages);
         return;
     }
 
+    const auto &session = Singletons::sessionModel();
+
     mPrevMessages.swap(mMessages);
     mMessages.clear();
 
@@ -226,23 +438,63 @@ void RenderSession::prepare(bool itemsChanged,
     mCommandQueue.reset(new CommandQueue());
     mUsedItems.clear();
 
-    const auto addCommand = [&](auto&& command) {
-        mCommandQueue->commands.emplace_back(std::move(command));
+    // resources of the previous queue are carried over, unless they
+    // depend on a modified item, an evaluation is reset or scripts changed
+    const auto modifiedItems = std::exchange(mModifiedItems, { });
+    const auto reuseResources = (mPrevCommandQueue &&
+        !std::exchange(mAllItemsModified, false) &&
+        mEvaluationType != EvaluationType::Reset);
+    auto invalidatedResources = QSet<ItemId>();
+    if (reuseResources)
+        for (auto itemId : modifiedItems)
+            invalidatedResources += mPrevCommandQueue->dependentResources.value(itemId);
+
+    auto &commands = mCommandQueue->commands;
+    auto &bindings = mCommandQueue->bindings;
+
+    const auto addCommand = [&](Command::Type type,
+            int index = 0, int operand = 0) {
+        commands.push_back({ type, index, operand });
+    };
+
+    const auto addBinding = [&](BindingKind kind, auto &list, auto &&binding) {
+        const auto slot = bindings.getSlot(kind, binding.name);
+        list.push_back(std::move(binding));
+        addCommand(Command::Type::SetBinding,
+            static_cast<int>(list.size() - 1), slot);
     };
 
     const auto addProgramOnce = [&](ItemId programId) {
-        return addOnce(mCommandQueue->programs,
-            session.findItem<Program>(programId));
+        const auto program = session.findItem<Program>(programId);
+        if (program && reuseResources)
+            reuseUnmodified(mCommandQueue->programs,
+                mPrevCommandQueue->programs, programId, invalidatedResources);
+        return addOnce(mCommandQueue->programs, program);
     };
 
     const auto addBufferOnce = [&](ItemId bufferId) {
-        return addOnce(mCommandQueue->buffers,
-            session.findItem<Buffer>(bufferId), *mScriptEngine);
+        const auto buffer = session.findItem<Buffer>(bufferId);
+        // sizes are evaluated again, since expressions can depend on scripts
+        if (buffer && reuseResources)
+            reuseUnmodified(mCommandQueue->buffers,
+                mPrevCommandQueue->buffers, bufferId, invalidatedResources,
+                [&](const GLBuffer &prev) {
+                    auto current = GLBuffer(*buffer, *mScriptEngine);
+                    current.updateUntitledFilename(prev);
+                    return (current == prev);
+                });
+        return addOnce(mCommandQueue->buffers, buffer, *mScriptEngine);
     };
 
     const auto addTextureOnce = [&](ItemId textureId) {
-        return addOnce(mCommandQueue->textures,
-            session.findItem<Texture>(textureId), *mScriptEngine);
+        const auto texture = session.findItem<Texture>(textureId);
+        if (texture && reuseResources)
+            reuseUnmodified(mCommandQueue->textures,
+                mPrevCommandQueue->textures, textureId, invalidatedResources,
+                [&](const GLTexture &prev) {
+                    return (GLTexture(*texture, *mScriptEngine) == prev);
+                });
+        return addOnce(mCommandQueue->textures, texture, *mScriptEngine);
     };
 
     const auto addTextureBufferOnce = [&](ItemId bufferId,
@@ -277,88 +529,75 @@ void RenderSession::prepare(bool itemsChanged,
         return vs;
     };
 
+    // loop index and index of its begin command
+    auto openLoops = std::vector<std::pair<int, int>>();
+
     session.forEachItem([&](const Item &item) {
 
-        if (auto group = castItem<Group>(item)) {
+        // empty groups are skipped
+        if (auto group = castItem<Group>(item); group && !group->items.isEmpty()) {
             const auto iterations =
                 mScriptEngine->evaluateInt(group->iterations, group->id, mMessages);
 
-            // mark begin of iteration
-            addCommand([this, groupId = group->id](BindingState &) {
-                auto &iterations = mGroupIterations[groupId];
-                iterations.iterationsLeft = iterations.iterations;
-            });
-            const auto commandQueueBeginIndex =
-                static_cast<int>(mCommandQueue->commands.size());
-            mGroupIterations[group->id] = { iterations, commandQueueBeginIndex, 0 };
+            // begin of loop, it is closed after last group item
+            const auto loopIndex =
+                static_cast<int>(mCommandQueue->loopIterations.size());
+            mCommandQueue->loopIterations.push_back(iterations);
+            openLoops.push_back({ loopIndex, static_cast<int>(commands.size()) });
+            addCommand(Command::Type::BeginLoop, loopIndex);
 
             // push binding scope
             if (!group->inlineScope)
-                addCommand([](BindingState &state) { state.push({ }); });
+                addCommand(Command::Type::PushScope);
         }
         else if (auto script = castItem<Script>(item)) {
             mUsedItems += script->id;
-            evaluateScript(*script);
+            evaluateScript(*script, mMessages);
         }
         else if (auto binding = castItem<Binding>(item)) {
             const auto &b = *binding;
             switch (b.bindingType) {
                 case Binding::BindingType::Uniform:
-                    addCommand(
-                        [binding = GLUniformBinding{
+                    addBinding(BindingKind::Uniform, bindings.uniforms,
+                        GLUniformBinding{
                             b.id, b.name, b.bindingType,
                             mScriptEngine->getVariable(b.name, b.values, b.id, mMessages),
-                            false }
-                        ](BindingState &state) {
-                            state.top().uniforms[binding.name] = binding;
-                        });
+                            false });
                     break;
 
                 case Binding::BindingType::Sampler:
-                    addCommand(
-                        [binding = GLSamplerBinding{
+                    addBinding(BindingKind::Sampler, bindings.samplers,
+                        GLSamplerBinding{
                             b.id, b.name, addTextureOnce(b.textureId),
                             b.minFilter, b.magFilter, b.anisotropic,
                             b.wrapModeX, b.wrapModeY, b.wrapModeZ,
                             b.borderColor,
-                            b.comparisonFunc }
-                        ](BindingState &state) {
-                            state.top().samplers[binding.name] = binding;
-                        });
+                            b.comparisonFunc });
                     break;
 
                 case Binding::BindingType::Image:
-                    addCommand(
-                        [binding = GLImageBinding{
+                    addBinding(BindingKind::Image, bindings.images,
+                        GLImageBinding{
                             b.id, b.name, addTextureOnce(b.textureId),
                             b.level, b.layer, GLenum{ GL_READ_WRITE },
-                            b.imageFormat }
-                        ](BindingState &state) {
-                            state.top().images[binding.name] = binding;
-                        });
+                            b.imageFormat });
                     break;
 
                 case Binding::BindingType::TextureBuffer: {
-                    addCommand(
-                        [binding = GLImageBinding{
+                    addBinding(BindingKind::Image, bindings.images,
+                        GLImageBinding{
                             b.id, b.name,
                             addTextureBufferOnce(b.bufferId, addBufferOnce(b.bufferId),
                                 static_cast<Texture::Format>(b.imageFormat)),
                             b.level, b.layer, GLenum{ GL_READ_WRITE },
-                            b.imageFormat }
-                        ](BindingState &state) {
-                            state.top().images[binding.name] = binding;
-                        });
+                            b.imageFormat });
                     break;
                 }
 
                 case Binding::BindingType::Buffer:
-                    addCommand(
-                        [binding = GLBufferBinding{
-                            b.id, b.name, addBufferOnce(b.bufferId), 0, 0, false }
-                        ](BindingState &state) {
-                            state.top().buffers[binding.name] = binding;
-                        });
+                    addBinding(BindingKind::Buffer, bindings.buffers,
+                        GLBufferBinding{
+                            b.id, b.name, addBufferOnce(b.bufferId), 0, 0, false });
                     break;
 
                 case Binding::BindingType::BufferBlock:
@@ -366,22 +605,16 @@ void RenderSession::prepare(bool itemsChanged,
                         const auto offset = mScriptEngine->evaluateInt(block->offset, b.blockId, mMessages);
                         const auto rowCount = mScriptEngine->evaluateInt(block->rowCount, b.blockId, mMessages);
                         const auto stride = getBlockStride(*block);
-                        addCommand(
-                            [binding = GLBufferBinding{
-                                b.id, b.name, addBufferOnce(block->parent->id), offset, rowCount * stride, false }
-                            ](BindingState &state) {
-                                state.top().buffers[binding.name] = binding;
-                            });
+                        addBinding(BindingKind::Buffer, bindings.buffers,
+                            GLBufferBinding{
+                                b.id, b.name, addBufferOnce(block->parent->id), offset, rowCount * stride, false });
                     }
                     break;
 
                 case Binding::BindingType::Subroutine:
-                    addCommand(
-                        [binding = GLSubroutineBinding{
-                            b.id, b.name, b.subroutine, {} }
-                        ](BindingState &state) {
-                            state.top().subroutines[binding.name] = binding;
-                        });
+                    addBinding(BindingKind::Subroutine, bindings.subroutines,
+                        GLSubroutineBinding{
+                            b.id, b.name, b.subroutine, {} });
                     break;
                 }
         }
@@ -428,36 +661,14 @@ void RenderSession::prepare(bool itemsChanged,
                         break;
                 }
 
-                addCommand(
-                    [this,
-                     executeOn = call->executeOn,
-                     call = std::move(glcall)
-                    ](BindingState &state) mutable {
-                        if (!shouldExecute(executeOn, mEvaluationType))
-                            return;
-
-                        if (auto program = call.program()) {
-                            mUsedItems += program->usedItems();
-                            if (!program->bind(&mMessages))
-                                return;
-                            mUsedItems += applyBindings(state, *program);
-                            call.execute(mMessages);
-                            program->unbind(call.itemId());
-                        }
-                        else {
-                            call.execute(mMessages);
-                        }
-
-                        if (!updatingPreviewTextures())
-                            if (auto timerQuery = call.timerQuery())
-                                mTimerQueries.append({ call.itemId(), timerQuery });
-                        mUsedItems += call.usedItems();
-                    });
+                addCommand(Command::Type::ExecuteCall,
+                    static_cast<int>(mCommandQueue->calls.size()));
+                mCommandQueue->calls.push_back({ call->executeOn, std::move(glcall) });
             }
         }
 
-        // pop binding scope(s) after last group item
-        if (!castItem<Group>(&item)) {
+        // pop binding scope(s) and close loop(s) after last group item
+        if (!castItem<Group>(&item) || item.items.isEmpty()) {
             auto it = &item;
             while (it && it->parent && it->parent->items.back() == it) {
                 auto group = castItem<Group>(it->parent);
@@ -465,26 +676,90 @@ void RenderSession::prepare(bool itemsChanged,
                     break;
 
                 if (!group->inlineScope)
-                    addCommand([](BindingState &state) {
-                        state.pop();
-                    });
-
-                addCommand([this, groupId = group->id](BindingState &) {
-                    // jump to begin of group
-                    auto &iteration = mGroupIterations[groupId];
-                    if (--iteration.iterationsLeft > 0)
-                        setNextCommandQueueIndex(iteration.commandQueueBeginIndex);
-                });
+                    addCommand(Command::Type::PopScope);
+
+                // jump to begin of loop body while iterations are left
+                const auto [loopIndex, beginIndex] = openLoops.back();
+                openLoops.pop_back();
+                addCommand(Command::Type::EndLoop, loopIndex, beginIndex + 1);
 
                 // undo pushing commands, when there is not a single iteration
-                const auto &iteration = mGroupIterations[group->id];
-                if (!iteration.iterations)
-                    mCommandQueue->commands.resize(iteration.commandQueueBeginIndex);
+                if (!mCommandQueue->loopIterations[loopIndex])
+                    commands.resize(beginIndex);
 
                 it = it->parent;
             }
         }
     });
+
+    // map items to the resources depending on them, for the next rebuild
+    auto &dependentResources = mCommandQueue->dependentResources;
+    const auto addDependencies = [&](const auto &resources) {
+        for (const auto &[id, resource] : resources)
+            for (auto itemId : resource.usedItems())
+                dependentResources[itemId] += id;
+    };
+    addDependencies(mCommandQueue->textures);
+    addDependencies(mCommandQueue->buffers);
+    addDependencies(mCommandQueue->programs);
+
+    // durations of calls are only averaged while they are unmodified
+    auto unmodifiedCalls = QSet<ItemId>();
+    if (reuseResources)
+        for (auto &[executeOn, call] : mCommandQueue->calls) {
+            auto usedItems = call.usedItems();
+            usedItems += call.itemId();
+            if (auto program = call.program())
+                usedItems += program->usedItems();
+            if (!usedItems.intersects(modifiedItems))
+                unmodifiedCalls += call.itemId();
+        }
+    resetCallDurations(unmodifiedCalls);
+
+    mGpupadScriptObject->applySessionUpdate(*mScriptEngine);
+}
+
+bool RenderSession::prepareAhead(EvaluationType evaluationType)
+{
+    // only variables can be updated while the command queue is rendered,
+    // their new values are applied in finish
+    if (!mScriptEngine || mItemsChanged ||
+        mEvaluationType != EvaluationType::Steady ||
+        evaluationType != EvaluationType::Steady)
+        return false;
+
+    updateMousePosition();
+    mScriptEngine->setDeferVariableUpdates(true);
+    reevaluateScripts(mPreparedAheadMessages);
+    mScriptEngine->setDeferVariableUpdates(false);
+    return true;
+}
+
+void RenderSession::updateMousePosition()
+{
+    if (!Singletons::headless())
+        mInputScriptObject->setMouseFragCoord(
+            Singletons::synchronizeLogic().mousePosition());
+}
+
+void RenderSession::evaluateScript(const Script &script,
+    MessagePtrSet &messages)
+{
+    if (shouldExecute(script.executeOn, mEvaluationType)) {
+        auto source = QString();
+        if (Singletons::fileCache().getSource(script.fileName, &source))
+            mScriptEngine->evaluateScript(source, script.fileName, messages);
+    }
+}
+
+void RenderSession::reevaluateScripts(MessagePtrSet &messages)
+{
+    mScriptEngine->updateVariables(messages);
+
+    Singletons::sessionModel().forEachItem([&](const Item &item) {
+        if (auto script = castItem<Script>(item))
+            evaluateScript(*script, messages);
+    });
     mGpupadScriptObject->applySessionUpdate(*mScriptEngine);
 }
 
@@ -508,6 +783,13 @@ void RenderSession::render()
         gl.glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
 #endif
 
+    // only complete downloads, which were not finished last time
+    if (std::exchange(mFinishingDownloads, false)) {
+        finishDownloads(true);
+        Q_ASSERT(glGetError() == GL_NO_ERROR);
+        return;
+    }
+
     reuseUnmodifiedItems();
     executeCommandQueue();
     downloadModifiedResources();
@@ -521,11 +803,17 @@ void RenderSession::render()
 void RenderSession::reuseUnmodifiedItems()
 {
     if (mPrevCommandQueue) {
-
         replaceEqual(mCommandQueue->textures, mPrevCommandQueue->textures);
         replaceEqual(mCommandQueue->buffers, mPrevCommandQueue->buffers);
         replaceEqual(mCommandQueue->programs, mPrevCommandQueue->programs);
+    }
+
+    // submit all programs before waiting for the first,
+    // so they can be compiled in parallel
+    for (auto &[id, program] : mCommandQueue->programs)
+        program.beginLink();
 
+    if (mPrevCommandQueue) {
         // immediately try to link programs
         // when failing restore previous version but keep error messages
         for (auto &[id, program] : mCommandQueue->programs) {
@@ -543,24 +831,75 @@ void RenderSession::reuseUnmodifiedItems()
     }
 }
 
-void RenderSession::setNextCommandQueueIndex(int index)
-{
-    mNextCommandQueueIndex = index;
-}
-
 void RenderSession::executeCommandQueue()
 {
     auto& context = GLContext::currentContext();
     Singletons::glShareSynchronizer().beginUpdate(context);
 
-    BindingState state;
+    auto &queue = *mCommandQueue;
+    auto state = BindingState(queue.bindings.slots.size());
+    auto iterationsLeft = std::vector<int>(queue.loopIterations.size());
+    auto hazardTracker = GLHazardTracker(mTrackMemoryBarriers);
+
+    for (auto index = 0; index < static_cast<int>(queue.commands.size()); ++index) {
+        const auto &command = queue.commands[index];
+        switch (command.type) {
+            case Command::Type::PushScope:
+                state.pushScope();
+                break;
+
+            case Command::Type::PopScope:
+                state.popScope();
+                break;
+
+            case Command::Type::SetBinding:
+                state.set(command.operand, command.index);
+                break;
+
+            case Command::Type::BeginLoop:
+                iterationsLeft[command.index] = queue.loopIterations[command.index];
+                break;
+
+            case Command::Type::EndLoop:
+                // jump to begin of loop body
+                if (--iterationsLeft[command.index] > 0)
+                    index = command.operand - 1;
+                break;
+
+            case Command::Type::ExecuteCall: {
+                auto &[executeOn, call] = queue.calls[command.index];
+                if (!shouldExecute(executeOn, mEvaluationType))
+                    break;
 
-    mNextCommandQueueIndex = 0;
-    while (mNextCommandQueueIndex < static_cast<int>(mCommandQueue->commands.size())) {
-        const auto index = mNextCommandQueueIndex++;
-        // executing command might call setNextCommandQueueIndex
-        mCommandQueue->commands[index](state);
+                auto program = call.program();
+                if (program) {
+                    mUsedItems += program->usedItems();
+                    if (!program->bind(&mMessages))
+                        break;
+                    trackBindings(state, queue.bindings, *program, hazardTracker);
+                }
+                call.trackResources(hazardTracker);
+                hazardTracker.beginCall();
+
+                if (program)
+                    mUsedItems += applyBindings(state, queue.bindings, *program);
+                call.execute(mMessages);
+                hazardTracker.endCall();
+                if (program)
+                    program->unbind(call.itemId());
+
+                if (!updatingPreviewTextures())
+                    if (auto timerQuery = call.timerQuery()) {
+                        // query is not added again while result is pending
+                        mTimerQueries.emplace(std::move(timerQuery), call.itemId());
+                        mTimedCalls += call.itemId();
+                    }
+                mUsedItems += call.usedItems();
+                break;
+            }
+        }
     }
+    hazardTracker.finish();
 
     Singletons::glShareSynchronizer().endUpdate(context);
 }
@@ -573,34 +912,142 @@ bool RenderSession::updatingPreviewTextures() const
 
 void RenderSession::downloadModifiedResources()
 {
-    for (auto &[itemId, texture] : mCommandQueue->textures) {
+    // copy to staging buffers, which are read once the fence is signaled
+    auto &queue = *mCommandQueue;
+    for (auto &[itemId, texture] : queue.textures) {
         texture.updateMipmaps();
         if (!updatingPreviewTextures() &&
             !texture.fileName().isEmpty() &&
-            texture.download())
-            mModifiedTextures[texture.itemId()] = texture.data();
+            texture.beginDownload())
+            queue.downloadingTextures.push_back(&texture);
     }
 
-    for (auto &[itemId, buffer] : mCommandQueue->buffers)
+    for (auto &[itemId, buffer] : queue.buffers)
         if (!buffer.fileName().isEmpty() &&
             (mItemsChanged || mEvaluationType != EvaluationType::Steady) &&
-            buffer.download())
-            mModifiedBuffers[buffer.itemId()] = buffer.data();
+            buffer.beginDownload())
+            queue.downloadingBuffers.push_back(&buffer);
+
+    if (!queue.downloadingTextures.empty() ||
+        !queue.downloadingBuffers.empty()) {
+        auto &gl = GLContext::currentContext();
+        queue.downloadFence = gl.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        gl.glFlush();
+        finishDownloads(false);
+    }
+}
+
+void RenderSession::finishDownloads(bool wait)
+{
+    auto &queue = *mCommandQueue;
+    if (!queue.downloadFence)
+        return;
+
+    auto &gl = GLContext::currentContext();
+    const auto timeout = GLuint64{ wait ? 1000000000u : 0u };
+    auto status = GLenum{ };
+    do {
+        status = gl.glClientWaitSync(queue.downloadFence,
+            GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    } while (wait && status == GL_TIMEOUT_EXPIRED);
+    if (status == GL_TIMEOUT_EXPIRED)
+        return;
+
+    gl.glDeleteSync(queue.downloadFence);
+    queue.downloadFence = { };
+
+    for (auto texture : queue.downloadingTextures)
+        if (texture->finishDownload())
+            mModifiedTextures[texture->itemId()] = texture->data();
+    queue.downloadingTextures.clear();
+
+    for (auto buffer : queue.downloadingBuffers)
+        if (buffer->finishDownload())
+            mModifiedBuffers[buffer->itemId()] = buffer->data();
+    queue.downloadingBuffers.clear();
 }
 
 void RenderSession::outputTimerQueries()
 {
+    // collect available results without waiting,
+    // durations are smoothed over multiple frames
+    for (auto it = mTimerQueries.begin(); it != mTimerQueries.end(); ) {
+        const auto &[query, itemId] = *it;
+        if (!query->isResultAvailable()) {
+            ++it;
+            continue;
+        }
+        if (!itemId) {
+            it = mTimerQueries.erase(it);
+            continue;
+        }
+        const auto duration = std::chrono::duration<double>(
+            std::chrono::nanoseconds(query->waitForResult()));
+        auto average = mCallDurations.find(itemId);
+        if (average == mCallDurations.end()) {
+            mCallDurations.insert(itemId, duration);
+        }
+        else {
+            *average += (duration - *average) * 0.2;
+        }
+        it = mTimerQueries.erase(it);
+    }
+
     mTimerMessages.clear();
-    for (const auto &[itemId, query] : qAsConst(mTimerQueries)) {
-        const auto duration = std::chrono::nanoseconds(query->waitForResult());
-        mTimerMessages += MessageList::insert(
-            itemId, MessageType::CallDuration,
-            formatQueryDuration(duration), false);
+    for (auto itemId : qAsConst(mTimedCalls)) {
+        const auto duration = mCallDurations.constFind(itemId);
+        if (duration != mCallDurations.constEnd())
+            mTimerMessages += MessageList::insert(
+                itemId, MessageType::CallDuration,
+                formatQueryDuration(*duration), false);
     }
-    mTimerQueries.clear();
+    mTimedCalls.clear();
+}
+
+void RenderSession::resetCallDurations(const QSet<ItemId> &unmodifiedCalls)
+{
+    for (auto it = mCallDurations.begin(); it != mCallDurations.end(); ) {
+        if (unmodifiedCalls.contains(it.key()))
+            ++it;
+        else
+            it = mCallDurations.erase(it);
+    }
+
+    // results of pending queries are discarded, queries are deleted on render thread
+    for (auto &[query, itemId] : mTimerQueries)
+        if (!unmodifiedCalls.contains(itemId))
+            itemId = 0;
 }
 
 void RenderSession::finish()
+{
+    if (Singletons::headless()) {
+        updateFileCache();
+    }
+    else {
+        updateEditors();
+    }
+
+    mPrevMessages.clear();
+
+    // apply evaluation, which was prepared while rendering
+    if (mScriptEngine)
+        mScriptEngine->applyDeferredVariableUpdates();
+    mMessages += mPreparedAheadMessages;
+    mPreparedAheadMessages.clear();
+    mTrackMemoryBarriers = Singletons::settings().trackMemoryBarriers();
+
+    // downloads still in flight are completed by another render pass
+    if (mCommandQueue && mCommandQueue->downloadFence) {
+        mFinishingDownloads = true;
+        renderAgain();
+    }
+
+    QMutexLocker lock{ &mUsedItemsCopyMutex };
+    mUsedItemsCopy = mUsedItems;
+}
+
+void RenderSession::updateEditors()
 {
     auto &editors = Singletons::editorManager();
     auto &session = Singletons::sessionModel();
@@ -628,16 +1075,34 @@ void RenderSession::finish()
                     if (auto editor = editors.getTextureEditor(fileItem->fileName))
                         if (auto textureId = texture.textureId())
                             editor->updatePreviewTexture(texture.target(), textureId);
+}
 
-    mPrevMessages.clear();
+void RenderSession::updateFileCache()
+{
+    // without editors the modified data is directly put into the file cache
+    auto &fileCache = Singletons::fileCache();
+    auto &session = Singletons::sessionModel();
 
-    QMutexLocker lock{ &mUsedItemsCopyMutex };
-    mUsedItemsCopy = mUsedItems;
+    for (auto itemId : mModifiedTextures.keys())
+        if (auto texture = session.findItem<Texture>(itemId))
+            fileCache.replaceTexture(texture->fileName, mModifiedTextures[itemId]);
+    mModifiedTextures.clear();
+
+    for (auto itemId : mModifiedBuffers.keys())
+        if (auto fileItem = castItem<FileItem>(session.findItem(itemId)))
+            fileCache.replaceBinary(fileItem->fileName, mModifiedBuffers[itemId]);
+    mModifiedBuffers.clear();
 }
 
 void RenderSession::release()
 {
+    if (mCommandQueue && mCommandQueue->downloadFence) {
+        auto &gl = GLContext::currentContext();
+        gl.glDeleteSync(mCommandQueue->downloadFence);
+    }
+    mFinishingDownloads = false;
     mCommandQueue.reset();
     mPrevCommandQueue.reset();
     mTimerQueries.clear();
+    mCallDurations.clear();
 }
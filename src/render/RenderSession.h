@@ -7,11 +7,15 @@
 #include <QMutex>
 #include <QMap>
 #include <memory>
+#include <map>
+#include <chrono>
 
 class ScriptEngine;
 class GpupadScriptObject;
 class InputScriptObject;
 class QOpenGLTimerQuery;
+class QModelIndex;
+struct Script;
 
 class RenderSession final : public RenderTask
 {
@@ -26,23 +30,26 @@ private:
     struct CommandQueue;
     struct TimerQueries;
 
-    struct GroupIteration {
-        int iterations;
-        int commandQueueBeginIndex;
-        int iterationsLeft;
-    };
-
     void prepare(bool itemsChanged,
         EvaluationType evaluationType) override;
+    bool prepareAhead(EvaluationType evaluationType) override;
     void render() override;
     void finish() override;
     void release() override;
 
+    void handleItemModified(const QModelIndex &index);
+    void handleRowsModified(const QModelIndex &parent, int first, int last);
+    void updateMousePosition();
+    void evaluateScript(const Script &script, MessagePtrSet &messages);
+    void reevaluateScripts(MessagePtrSet &messages);
     void reuseUnmodifiedItems();
     void executeCommandQueue();
-    void setNextCommandQueueIndex(int index);
     void downloadModifiedResources();
+    void finishDownloads(bool wait);
     void outputTimerQueries();
+    void resetCallDurations(const QSet<ItemId> &unmodifiedCalls);
+    void updateEditors();
+    void updateFileCache();
     bool updatingPreviewTextures() const;
 
     QScopedPointer<ScriptEngine> mScriptEngine;
@@ -50,17 +57,22 @@ private:
     InputScriptObject *mInputScriptObject{ };
     QScopedPointer<CommandQueue> mCommandQueue;
     QScopedPointer<CommandQueue> mPrevCommandQueue;
-    int mNextCommandQueueIndex{ };
-    QMap<ItemId, GroupIteration> mGroupIterations;
     QSet<ItemId> mUsedItems;
     QMap<ItemId, TextureData> mModifiedTextures;
     QMap<ItemId, QByteArray> mModifiedBuffers;
-    QList<std::pair<ItemId, std::shared_ptr<const QOpenGLTimerQuery>>> mTimerQueries;
+    std::map<std::shared_ptr<const QOpenGLTimerQuery>, ItemId> mTimerQueries;
+    QSet<ItemId> mTimedCalls;
+    QMap<ItemId, std::chrono::duration<double>> mCallDurations;
     MessagePtrSet mMessages;
     MessagePtrSet mPrevMessages;
+    MessagePtrSet mPreparedAheadMessages;
     MessagePtrSet mTimerMessages;
+    QSet<ItemId> mModifiedItems;
+    bool mAllItemsModified{ true };
     bool mItemsChanged{ };
+    bool mFinishingDownloads{ };
     EvaluationType mEvaluationType{ };
+    bool mTrackMemoryBarriers{ };
 
     mutable QMutex mUsedItemsCopyMutex;
     QSet<ItemId> mUsedItemsCopy;
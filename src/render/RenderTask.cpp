@@ -1,6 +1,7 @@
 #include "RenderTask.h"
 #include "Singletons.h"
 #include "Renderer.h"
+#include <utility>
 
 RenderTask::RenderTask(QObject *parent) : QObject(parent)
 {
@@ -16,6 +17,8 @@ void RenderTask::releaseResources()
     Q_ASSERT(!mReleased);
     mReleased = true;
     mItemsChanged = false;
+    mRenderAgain = false;
+    mPreparedAhead = false;
     mPendingEvaluation.reset();
     Singletons::renderer().release(this);
 }
@@ -28,6 +31,13 @@ void RenderTask::update(bool itemsChanged, EvaluationType evaluationType)
         prepare(itemsChanged, evaluationType);
         Singletons::renderer().render(this);
     }
+    else if (!itemsChanged && !mItemsChanged && !mPreparedAhead &&
+             !mPendingEvaluation.has_value() &&
+             evaluationType == EvaluationType::Steady &&
+             prepareAhead(evaluationType)) {
+        // rendered as soon as current evaluation finished
+        mPreparedAhead = true;
+    }
     else {
         mItemsChanged |= itemsChanged;
         if (evaluationType != EvaluationType::Steady)
@@ -36,9 +46,26 @@ void RenderTask::update(bool itemsChanged, EvaluationType evaluationType)
     }
 }
 
+void RenderTask::renderAgain()
+{
+    Q_ASSERT(mUpdating);
+    mRenderAgain = true;
+}
+
 void RenderTask::handleRendered()
 {
     finish();
+
+    if (std::exchange(mRenderAgain, false)) {
+        Singletons::renderer().render(this);
+        return;
+    }
+
+    if (std::exchange(mPreparedAhead, false)) {
+        Singletons::renderer().render(this);
+        Q_EMIT updated();
+        return;
+    }
     mUpdating = false;
 
     Q_EMIT updated();
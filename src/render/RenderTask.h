@@ -26,6 +26,10 @@ Q_SIGNALS:
 protected:
     void releaseResources();
 
+    // can be called by finish, to have render called once again
+    // without prepare, e.g. to complete work still pending on the GPU
+    void renderAgain();
+
 private:
     friend class Renderer;
 
@@ -33,6 +37,10 @@ private:
     virtual void prepare(bool itemsChanged,
         EvaluationType evaluationType) = 0;
 
+    // 1b. called in main thread while previous evaluation is rendered,
+    // returns false when evaluation cannot be prepared concurrently
+    virtual bool prepareAhead(EvaluationType) { return false; }
+
     // 2. called in render thread
     virtual void render() = 0;
 
@@ -47,6 +55,8 @@ private:
     bool mReleased{ };
     bool mUpdating{ };
     bool mItemsChanged{ };
+    bool mRenderAgain{ };
+    bool mPreparedAhead{ };
     std::optional<EvaluationType> mPendingEvaluation;
 };
 
@@ -134,6 +134,22 @@ void GpupadScriptObject::setBlockData(QJsonValue item, QJSValue data)
                 buffer, SessionModel::FileName), fileName);
         }
 
+        if (Singletons::headless()) {
+            auto ok = true;
+            const auto offset = (block->evaluatedOffset ?
+                block->evaluatedOffset : evaluateIntExpression(block->offset, &ok));
+            if (ok) {
+                auto binary = QByteArray();
+                Singletons::fileCache().getBinary(buffer->fileName, &binary);
+                const auto bytes = toByteArray(data, *block);
+                if (offset + bytes.size() > binary.size())
+                    binary.resize(offset + bytes.size());
+                std::memcpy(binary.data() + offset, bytes.constData(), bytes.size());
+                Singletons::fileCache().replaceBinary(buffer->fileName, binary);
+            }
+            return;
+        }
+
         auto &editors = Singletons::editorManager();
         editors.setAutoRaise(false);
         auto editor = editors.openBinaryEditor(buffer->fileName);
@@ -155,6 +171,9 @@ void GpupadScriptObject::setBlockData(QJsonValue item, QJSValue data)
 
 QString GpupadScriptObject::openFileDialog()
 {
+    if (Singletons::headless())
+        return { };
+
     auto options = FileDialog::Options();
     if (Singletons::fileDialog().exec(options))
         return Singletons::fileDialog().fileName();
@@ -172,6 +191,9 @@ QString GpupadScriptObject::readTextFile(const QString &fileName)
 bool GpupadScriptObject::openWebDock()
 {
 #if defined(Qt5WebEngineWidgets_FOUND)
+    if (Singletons::headless())
+        return false;
+
     class CustomEditor : public IEditor
     {
     public:
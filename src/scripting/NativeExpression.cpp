@@ -0,0 +1,475 @@
+#include "NativeExpression.h"
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+namespace {
+    const auto NaN = std::numeric_limits<double>::quiet_NaN();
+    const auto Infinity = std::numeric_limits<double>::infinity();
+
+    double round(double x)
+    {
+        // ties are rounded towards +Infinity, -0.5 <= x < 0 yields -0
+        const auto r = std::floor(x);
+        const auto result = (x - r >= 0.5 ? r + 1 : r);
+        return (result == 0 && std::signbit(x) ? -0.0 : result);
+    }
+
+    double pow(double x, double y)
+    {
+        if (std::isnan(y) || (std::fabs(x) == 1 && std::isinf(y)))
+            return NaN;
+        return std::pow(x, y);
+    }
+
+    double sign(double x)
+    {
+        return (std::isnan(x) || x == 0 ? x : x > 0 ? 1.0 : -1.0);
+    }
+
+    double max(const double *args, int count)
+    {
+        auto result = -Infinity;
+        for (auto i = 0; i < count; ++i) {
+            const auto v = args[i];
+            if (std::isnan(v))
+                return NaN;
+            if (v > result || (v == result && !std::signbit(v)))
+                result = v;
+        }
+        return result;
+    }
+
+    double min(const double *args, int count)
+    {
+        auto result = Infinity;
+        for (auto i = 0; i < count; ++i) {
+            const auto v = args[i];
+            if (std::isnan(v))
+                return NaN;
+            if (v < result || (v == result && std::signbit(v)))
+                result = v;
+        }
+        return result;
+    }
+
+    struct Function
+    {
+        const char *name;
+        int arguments;
+        double (*function)(const double *args, int count);
+    };
+
+    // arguments which are not passed are undefined (NaN),
+    // additional arguments are ignored, like in JavaScript
+    const Function gFunctions[] = {
+        { "abs", 1, [](const double *a, int) { return std::fabs(a[0]); } },
+        { "acos", 1, [](const double *a, int) { return std::acos(a[0]); } },
+        { "asin", 1, [](const double *a, int) { return std::asin(a[0]); } },
+        { "atan", 1, [](const double *a, int) { return std::atan(a[0]); } },
+        { "atan2", 2, [](const double *a, int) { return std::atan2(a[0], a[1]); } },
+        { "ceil", 1, [](const double *a, int) { return std::ceil(a[0]); } },
+        { "cos", 1, [](const double *a, int) { return std::cos(a[0]); } },
+        { "exp", 1, [](const double *a, int) { return std::exp(a[0]); } },
+        { "floor", 1, [](const double *a, int) { return std::floor(a[0]); } },
+        { "log", 1, [](const double *a, int) { return std::log(a[0]); } },
+        { "log10", 1, [](const double *a, int) { return std::log10(a[0]); } },
+        { "log2", 1, [](const double *a, int) { return std::log2(a[0]); } },
+        { "max", -1, max },
+        { "min", -1, min },
+        { "pow", 2, [](const double *a, int) { return pow(a[0], a[1]); } },
+        { "round", 1, [](const double *a, int) { return round(a[0]); } },
+        { "sign", 1, [](const double *a, int) { return sign(a[0]); } },
+        { "sin", 1, [](const double *a, int) { return std::sin(a[0]); } },
+        { "sqrt", 1, [](const double *a, int) { return std::sqrt(a[0]); } },
+        { "tan", 1, [](const double *a, int) { return std::tan(a[0]); } },
+        { "trunc", 1, [](const double *a, int) { return std::trunc(a[0]); } },
+    };
+
+    const std::pair<const char*, double> gConstants[] = {
+        { "E", 2.718281828459045 },
+        { "LN10", 2.302585092994046 },
+        { "LN2", 0.6931471805599453 },
+        { "LOG10E", 0.4342944819032518 },
+        { "LOG2E", 1.4426950408889634 },
+        { "PI", 3.141592653589793 },
+        { "SQRT1_2", 0.7071067811865476 },
+        { "SQRT2", 1.4142135623730951 },
+    };
+
+    bool isIdentifierStart(QChar c)
+    {
+        return (c.isLetter() || c == '_' || c == '$');
+    }
+
+    bool isIdentifierPart(QChar c)
+    {
+        return (isIdentifierStart(c) || c.isDigit());
+    }
+
+    double apply(int functionIndex, const double *args, int count)
+    {
+        const auto &function = gFunctions[functionIndex];
+        if (function.arguments < 0 || count >= function.arguments)
+            return function.function(args, count);
+
+        double padded[2] = { NaN, NaN };
+        for (auto i = 0; i < count; ++i)
+            padded[i] = args[i];
+        return function.function(padded, function.arguments);
+    }
+} // namespace
+
+class NativeExpression::Parser
+{
+public:
+    Parser(const QString &source, NativeExpression &expression)
+        : mSource(source)
+        , mProgram(expression.mProgram)
+        , mGlobals(expression.mGlobals) { }
+
+    bool parse()
+    {
+        return (parseAdditive() && (skipSpace(), atEnd()));
+    }
+
+private:
+    bool atEnd() const { return (mPos >= mSource.size()); }
+    QChar peek(int offset = 0) const
+    {
+        return (mPos + offset < mSource.size() ? mSource[mPos + offset] : QChar());
+    }
+
+    void skipSpace()
+    {
+        while (!atEnd() && peek().isSpace())
+            ++mPos;
+    }
+
+    bool accept(char c)
+    {
+        skipSpace();
+        if (peek() != c)
+            return false;
+        ++mPos;
+        return true;
+    }
+
+    bool parseAdditive()
+    {
+        if (!parseMultiplicative())
+            return false;
+        for (;;) {
+            if (accept('+')) {
+                if (!parseMultiplicative())
+                    return false;
+                emitBinary(Op::Add);
+            }
+            else if (accept('-')) {
+                if (!parseMultiplicative())
+                    return false;
+                emitBinary(Op::Subtract);
+            }
+            else {
+                return true;
+            }
+        }
+    }
+
+    bool parseMultiplicative()
+    {
+        if (!parseUnary())
+            return false;
+        for (;;) {
+            skipSpace();
+            // exponentiation and compound operators are not supported
+            if ((peek() == '*' || peek() == '/' || peek() == '%') &&
+                (peek(1) == '*' || peek(1) == '='))
+                return false;
+            if (accept('*')) {
+                if (!parseUnary())
+                    return false;
+                emitBinary(Op::Multiply);
+            }
+            else if (accept('/')) {
+                if (!parseUnary())
+                    return false;
+                emitBinary(Op::Divide);
+            }
+            else if (accept('%')) {
+                if (!parseUnary())
+                    return false;
+                emitBinary(Op::Modulo);
+            }
+            else {
+                return true;
+            }
+        }
+    }
+
+    bool parseUnary()
+    {
+        skipSpace();
+        // increment and decrement are not supported
+        if ((peek() == '+' || peek() == '-') && peek(1) == peek())
+            return false;
+        if (accept('+'))
+            return parseUnary();
+        if (accept('-')) {
+            if (!parseUnary())
+                return false;
+            if (mProgram.back().op == Op::Constant) {
+                mProgram.back().value = -mProgram.back().value;
+            }
+            else {
+                mProgram.push_back({ Op::Negate, 0, 0, 0 });
+            }
+            return true;
+        }
+        return parsePrimary();
+    }
+
+    bool parsePrimary()
+    {
+        skipSpace();
+        if (accept('('))
+            return (parseAdditive() && accept(')'));
+        if (peek().isDigit() || (peek() == '.' && peek(1).isDigit()))
+            return parseNumber();
+        if (isIdentifierStart(peek()))
+            return parseIdentifier();
+        return false;
+    }
+
+    bool parseNumber()
+    {
+        const auto begin = mPos;
+        auto value = 0.0;
+        if (peek() == '0' && (peek(1) == 'x' || peek(1) == 'X')) {
+            mPos += 2;
+            while (!atEnd() && isxdigit(peek().toLatin1()))
+                ++mPos;
+            auto ok = false;
+            value = static_cast<double>(
+                mSource.mid(begin + 2, mPos - begin - 2).toULongLong(&ok, 16));
+            if (!ok)
+                return false;
+        }
+        else {
+            // legacy octal literals are not supported
+            if (peek() == '0' && peek(1).isDigit())
+                return false;
+            while (peek().isDigit())
+                ++mPos;
+            if (peek() == '.') {
+                ++mPos;
+                while (peek().isDigit())
+                    ++mPos;
+            }
+            if (peek() == 'e' || peek() == 'E') {
+                ++mPos;
+                if (peek() == '+' || peek() == '-')
+                    ++mPos;
+                if (!peek().isDigit())
+                    return false;
+                while (peek().isDigit())
+                    ++mPos;
+            }
+            auto ok = false;
+            value = mSource.mid(begin, mPos - begin).toDouble(&ok);
+            if (!ok)
+                return false;
+        }
+        if (isIdentifierPart(peek()) || peek() == '.')
+            return false;
+        mProgram.push_back({ Op::Constant, value, 0, 0 });
+        return true;
+    }
+
+    QString parseName()
+    {
+        const auto begin = mPos;
+        while (isIdentifierPart(peek()))
+            ++mPos;
+        return mSource.mid(begin, mPos - begin);
+    }
+
+    bool parseIdentifier()
+    {
+        const auto name = parseName();
+        skipSpace();
+        if (peek() == '.') {
+            if (name != "Math")
+                return false;
+            ++mPos;
+            skipSpace();
+            if (!isIdentifierStart(peek()))
+                return false;
+            return parseMath(parseName());
+        }
+
+        if (peek() == '(' || peek() == '[' || peek() == '=')
+            return false;
+        if (name == "Infinity" || name == "NaN") {
+            mProgram.push_back({ Op::Constant,
+                (name == "NaN" ? NaN : Infinity), 0, 0 });
+            return true;
+        }
+        if (name == "Math")
+            return false;
+
+        auto index = mGlobals.indexOf(name);
+        if (index < 0) {
+            index = mGlobals.size();
+            mGlobals.append(name);
+        }
+        mProgram.push_back({ Op::Global, 0, index, 0 });
+        return true;
+    }
+
+    bool parseMath(const QString &name)
+    {
+        for (const auto &[constant, value] : gConstants)
+            if (name == QLatin1String(constant)) {
+                if (accept('('))
+                    return false;
+                mProgram.push_back({ Op::Constant, value, 0, 0 });
+                return true;
+            }
+
+        auto index = 0;
+        for (const auto &function : gFunctions) {
+            if (name == QLatin1String(function.name))
+                break;
+            ++index;
+        }
+        if (index == static_cast<int>(std::size(gFunctions)) || !accept('('))
+            return false;
+
+        auto arguments = 0;
+        if (!accept(')')) {
+            do {
+                if (!parseAdditive())
+                    return false;
+                ++arguments;
+            } while (accept(','));
+            if (!accept(')'))
+                return false;
+        }
+        emitCall(index, arguments);
+        return true;
+    }
+
+    // whether the operands of the last instruction are constants
+    bool operandsAreConstants() const
+    {
+        const auto count = static_cast<size_t>(mProgram.back().arguments);
+        if (mProgram.size() < count + 1)
+            return false;
+        for (auto i = mProgram.size() - count - 1; i < mProgram.size() - 1; ++i)
+            if (mProgram[i].op != Op::Constant)
+                return false;
+        return true;
+    }
+
+    void emitBinary(Op op)
+    {
+        mProgram.push_back({ op, 0, 0, 2 });
+        if (operandsAreConstants())
+            fold();
+    }
+
+    void emitCall(int index, int arguments)
+    {
+        mProgram.push_back({ Op::Call, 0, index, arguments });
+        if (operandsAreConstants())
+            fold();
+    }
+
+    // evaluate trailing instruction with constant operands at compile time
+    void fold()
+    {
+        auto expression = NativeExpression();
+        const auto operands = mProgram.back().arguments;
+        expression.mProgram.assign(mProgram.end() - operands - 1, mProgram.end());
+        auto value = 0.0;
+        expression.evaluate({ }, &value);
+        mProgram.resize(mProgram.size() - static_cast<size_t>(operands) - 1);
+        mProgram.push_back({ Op::Constant, value, 0, 0 });
+    }
+
+    const QString &mSource;
+    std::vector<Instruction> &mProgram;
+    QStringList &mGlobals;
+    int mPos{ };
+};
+
+bool NativeExpression::parse(const QString &expression)
+{
+    mProgram.clear();
+    mGlobals.clear();
+    auto parser = Parser(expression, *this);
+    if (parser.parse())
+        return true;
+
+    mProgram.clear();
+    mGlobals.clear();
+    return false;
+}
+
+bool NativeExpression::evaluate(const GetGlobal &getGlobal, double *result) const
+{
+    if (mProgram.empty())
+        return false;
+
+    auto stack = std::vector<double>();
+    stack.reserve(mProgram.size());
+    for (const auto &instruction : mProgram) {
+        switch (instruction.op) {
+            case Op::Constant:
+                stack.push_back(instruction.value);
+                break;
+
+            case Op::Global: {
+                auto value = 0.0;
+                if (!getGlobal || !getGlobal(mGlobals[instruction.index], &value))
+                    return false;
+                stack.push_back(value);
+                break;
+            }
+
+            case Op::Negate:
+                stack.back() = -stack.back();
+                break;
+
+            case Op::Add:
+            case Op::Subtract:
+            case Op::Multiply:
+            case Op::Divide:
+            case Op::Modulo: {
+                const auto b = stack.back();
+                stack.pop_back();
+                auto &a = stack.back();
+                switch (instruction.op) {
+                    case Op::Add: a = a + b; break;
+                    case Op::Subtract: a = a - b; break;
+                    case Op::Multiply: a = a * b; break;
+                    case Op::Divide: a = a / b; break;
+                    default: a = std::fmod(a, b); break;
+                }
+                break;
+            }
+
+            case Op::Call: {
+                const auto count = instruction.arguments;
+                const auto args = stack.data() + stack.size() - count;
+                const auto value = apply(instruction.index, args, count);
+                stack.resize(stack.size() - static_cast<size_t>(count));
+                stack.push_back(value);
+                break;
+            }
+        }
+    }
+    *result = stack.back();
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef NATIVEEXPRESSION_H
+#define NATIVEEXPRESSION_H
+
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <vector>
+
+// subset of JavaScript expressions, which can be evaluated without a
+// script engine: numbers, + - * / %, parentheses, Math functions/constants
+// and globals, which have a number value
+class NativeExpression
+{
+public:
+    using GetGlobal = std::function<bool(const QString &name, double *value)>;
+
+    // returns false when the expression needs a script engine
+    bool parse(const QString &expression);
+
+    // returns false when a global is not a number
+    bool evaluate(const GetGlobal &getGlobal, double *result) const;
+
+private:
+    enum class Op
+    {
+        Constant, Global,
+        Negate, Add, Subtract, Multiply, Divide, Modulo,
+        Call,
+    };
+
+    struct Instruction
+    {
+        Op op;
+        double value;
+        int index;
+        int arguments;
+    };
+
+    class Parser;
+
+    std::vector<Instruction> mProgram;
+    QStringList mGlobals;
+};
+
+#endif // NATIVEEXPRESSION_H
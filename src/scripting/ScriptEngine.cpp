@@ -3,12 +3,78 @@
 #include "session/SessionModel.h"
 #include "FileDialog.h"
 #include <QThread>
-#include <QTimer>
 #include <QMutex>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <algorithm>
+#include <vector>
 
 namespace {
     MessagePtrSet* gCurrentMessageList;
 
+    // single thread interrupting engines which exceeded their deadline
+    class Watchdog final : public QThread
+    {
+    public:
+        using Deadline = std::shared_ptr<std::atomic<qint64>>;
+
+        static Watchdog &instance()
+        {
+            static Watchdog sWatchdog;
+            return sWatchdog;
+        }
+
+        static qint64 now()
+        {
+            return instance().mClock.elapsed();
+        }
+
+        ~Watchdog() override
+        {
+            requestInterruption();
+            wait();
+        }
+
+        void add(QJSEngine *engine, Deadline deadline)
+        {
+            QMutexLocker lock(&mMutex);
+            mEngines.push_back({ engine, std::move(deadline) });
+            if (!isRunning())
+                start(QThread::LowPriority);
+        }
+
+        void remove(QJSEngine *engine)
+        {
+            QMutexLocker lock(&mMutex);
+            mEngines.erase(std::remove_if(mEngines.begin(), mEngines.end(),
+                [&](const auto &entry) { return entry.first == engine; }),
+                mEngines.end());
+        }
+
+    private:
+        Watchdog() { mClock.start(); }
+
+        void run() override
+        {
+            while (!isInterruptionRequested()) {
+                QThread::msleep(50);
+
+                QMutexLocker lock(&mMutex);
+                const auto time = now();
+                for (const auto &[engine, deadline] : mEngines) {
+                    auto expired = deadline->load();
+                    if (expired && expired < time &&
+                        deadline->compare_exchange_strong(expired, 0))
+                        engine->setInterrupted(true);
+                }
+            }
+        }
+
+        QElapsedTimer mClock;
+        QMutex mMutex;
+        std::vector<std::pair<QJSEngine*, Deadline>> mEngines;
+    };
+
     void consoleMessageHandler(QtMsgType type,
         const QMessageLogContext &context, const QString &msg)
     {
@@ -32,6 +98,25 @@ namespace {
         qInstallMessageHandler(prevMessageHandler);
         gCurrentMessageList = nullptr;
     }
+
+    // expressions are parsed once, since they are evaluated repeatedly
+    bool evaluateNativeExpression(const QString &expression, double *value)
+    {
+        const auto maxCachedExpressions = 1024;
+        static QMutex sMutex;
+        static QHash<QString, NativeExpression> sExpressions;
+        QMutexLocker lock(&sMutex);
+
+        auto it = sExpressions.find(expression);
+        if (it == sExpressions.end()) {
+            if (sExpressions.size() >= maxCachedExpressions)
+                sExpressions.clear();
+            auto native = NativeExpression();
+            native.parse(expression);
+            it = sExpressions.insert(expression, native);
+        }
+        return it->evaluate({ }, value);
+    }
 } // namespace
 
 ScriptValue evaluateValueExpression(const QString &expression, bool *ok)
@@ -45,10 +130,15 @@ ScriptValue evaluateValueExpression(const QString &expression, bool *ok)
         return 0;
     }
         
-    const auto value = expression.toDouble(ok);
+    auto value = expression.toDouble(ok);
     if (*ok)
         return value;
 
+    if (evaluateNativeExpression(expression, &value)) {
+        *ok = true;
+        return value;
+    }
+
     static QJSEngine sJsEngine;
     const auto result = sJsEngine.evaluate(expression);
     if (result.isError()) {
@@ -82,16 +172,10 @@ ScriptEngine::ScriptEngine(QObject *parent)
     : QObject(parent)
     , mOnThread(*QThread::currentThread())
     , mJsEngine(new QJSEngine(this))
+    , mDeadline(std::make_shared<std::atomic<qint64>>(0))
 {
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
-    mInterruptThread = new QThread();
-    mInterruptTimer = new QTimer();
-    mInterruptTimer->setInterval(1000);
-    mInterruptTimer->setSingleShot(true);
-    connect(mInterruptTimer, &QTimer::timeout,
-        [jsEngine = mJsEngine]() { jsEngine->setInterrupted(true); });
-    mInterruptTimer->moveToThread(mInterruptThread);
-    mInterruptThread->start();
+    Watchdog::instance().add(mJsEngine, mDeadline);
 #endif
 
     mJsEngine->installExtensions(QJSEngine::ConsoleExtension);
@@ -113,20 +197,89 @@ ScriptEngine::ScriptEngine(QObject *parent)
 ScriptEngine::~ScriptEngine() 
 {
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
-    QMetaObject::invokeMethod(mInterruptTimer, "stop", Qt::BlockingQueuedConnection);
-    connect(mInterruptThread, &QThread::finished, mInterruptThread, &QObject::deleteLater);
-    mInterruptThread->requestInterruption();
+    Watchdog::instance().remove(mJsEngine);
 #endif
 }
 
-QJSValue ScriptEngine::evaluate(const QString &program, const QString &fileName, int lineNumber)
+template<typename F>
+QJSValue ScriptEngine::interruptible(F &&function)
 {
     Q_ASSERT(&mOnThread == QThread::currentThread());
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
-    QMetaObject::invokeMethod(mInterruptTimer, "start", Qt::BlockingQueuedConnection);
-    mJsEngine->setInterrupted(false);
+    // only the outermost call may reset an interruption
+    const auto prevDeadline = mDeadline->exchange(Watchdog::now() + 1000);
+    if (!mInterruptibleDepth++)
+        mJsEngine->setInterrupted(false);
+    auto result = function();
+    --mInterruptibleDepth;
+    mDeadline->store(prevDeadline);
+    return result;
+#else
+    return function();
 #endif
-    return mJsEngine->evaluate(program, fileName, lineNumber);
+}
+
+QJSValue ScriptEngine::evaluate(const QString &program, const QString &fileName, int lineNumber)
+{
+    return interruptible([&]() {
+        return mJsEngine->evaluate(program, fileName, lineNumber);
+    });
+}
+
+QJSValue ScriptEngine::evaluateExpression(const QString &expression)
+{
+    // simple arithmetic expressions are evaluated natively, others are
+    // compiled to a function once, unless it is not a single expression,
+    // which is then evaluated every time
+    const auto compile = [&]() {
+        // a leading brace or declaration would no longer be a statement
+        static const auto sStatement = QRegularExpression(
+            "^\\s*(\\{|function\\b|class\\b)");
+        if (sStatement.match(expression).hasMatch())
+            return QJSValue();
+
+        // closing the parentheses (e.g. "a), (b") fails within brackets
+        const auto array = evaluate("(function() { return [" + expression + "\n]; })");
+        if (array.isError() || !array.isCallable())
+            return QJSValue();
+
+        auto function = evaluate("(function() { return (" + expression + "\n); })");
+        if (function.isError() || !function.isCallable())
+            return QJSValue();
+        return function;
+    };
+
+    auto it = mExpressions.find(expression);
+    if (it == mExpressions.end()) {
+        auto compiled = CompiledExpression();
+        compiled.isNative = compiled.native.parse(expression);
+        if (!compiled.isNative)
+            compiled.function = compile();
+        it = mExpressions.insert(expression, compiled);
+    }
+
+    if (it->isNative) {
+        const auto getGlobal = [&](const QString &name, double *value) {
+            const auto global = mJsEngine->globalObject().property(name);
+            if (!global.isNumber())
+                return false;
+            *value = global.toNumber();
+            return true;
+        };
+        auto value = 0.0;
+        if (it->native.evaluate(getGlobal, &value))
+            return QJSValue(value);
+
+        // a global is not a number, continue with script engine
+        it->isNative = false;
+        it->function = compile();
+    }
+
+    if (!it->function.isCallable())
+        return evaluate(expression);
+
+    auto function = it->function;
+    return interruptible([&]() { return function.call(); });
 }
 
 void ScriptEngine::setGlobal(const QString &name, QJSValue value)
@@ -205,7 +358,7 @@ ScriptValueList ScriptEngine::evaluateValues(const QStringList &valueExpressions
                 continue;
             }
 
-            auto result = evaluate(valueExpression);
+            auto result = evaluateExpression(valueExpression);
             if (result.isError())
                 messages += MessageList::insert(
                     itemId, MessageType::ScriptError, result.toString());
@@ -257,14 +410,34 @@ bool ScriptEngine::updateVariable(const Variable &variable,
     auto values = variable.values.lock();
     if (!values)
         return false;
-    *values = evaluateValues(variable.expressions, itemId, messages);
+
+    auto newValues = evaluateValues(variable.expressions, itemId, messages);
 
     // set global in script state, when variable name is known
     if (!variable.name.isEmpty())
-        setGlobal(variable.name, *values);
+        setGlobal(variable.name, newValues);
+
+    if (mDeferVariableUpdates) {
+        mDeferredUpdates.emplace_back(values, std::move(newValues));
+    }
+    else {
+        *values = std::move(newValues);
+    }
     return true;
 }
 
+void ScriptEngine::setDeferVariableUpdates(bool defer)
+{
+    mDeferVariableUpdates = defer;
+}
+
+void ScriptEngine::applyDeferredVariableUpdates()
+{
+    for (auto &[values, newValues] : mDeferredUpdates)
+        *values = std::move(newValues);
+    mDeferredUpdates.clear();
+}
+
 ScriptVariable ScriptEngine::getVariable(const QString &variableName,
     const QStringList &valueExpressions,
     ItemId itemId, MessagePtrSet &messages)
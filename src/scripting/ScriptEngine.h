@@ -2,12 +2,17 @@
 #define SCRIPTENGINE_H
 
 #include "MessageList.h"
+#include "NativeExpression.h"
 #include <QJSEngine>
 #include <QJSValue>
+#include <QHash>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <utility>
 
 using ScriptValue = double;
 using ScriptValueList = QList<ScriptValue>;
-class QTimer;
 
 class ScriptVariable
 {
@@ -44,6 +49,8 @@ public:
       ItemId itemId, MessagePtrSet &messages);
 
     void updateVariables(MessagePtrSet &messages);
+    void setDeferVariableUpdates(bool defer);
+    void applyDeferredVariableUpdates();
     ScriptVariable getVariable(const QString &variableName,
         const QStringList &valueExpressions,
         ItemId itemId, MessagePtrSet &messages);
@@ -55,6 +62,12 @@ public:
     QJSValue toJsValue(const T &value) { return mJsEngine->toScriptValue(value); }
 
 private:
+    struct CompiledExpression {
+        NativeExpression native;
+        bool isNative;
+        QJSValue function;
+    };
+
     struct Variable {
         QString name;
         QStringList expressions;
@@ -62,13 +75,19 @@ private:
     };
 
     QJSValue evaluate(const QString &program, const QString &fileName = QString(), int lineNumber = 1);
+    QJSValue evaluateExpression(const QString &expression);
+    template<typename F>
+    QJSValue interruptible(F &&function);
     bool updateVariable(const Variable &variable, ItemId itemId, MessagePtrSet &messages);
 
     const QThread& mOnThread;
     QJSEngine *mJsEngine{ };
-    QThread *mInterruptThread{ };
-    QTimer *mInterruptTimer{ };
+    std::shared_ptr<std::atomic<qint64>> mDeadline;
+    int mInterruptibleDepth{ };
+    QHash<QString, CompiledExpression> mExpressions;
     QList<Variable> mVariables;
+    bool mDeferVariableUpdates{ };
+    std::vector<std::pair<QSharedPointer<ScriptValueList>, ScriptValueList>> mDeferredUpdates;
 };
 
 ScriptValue evaluateValueExpression(const QString &expression, bool *ok);
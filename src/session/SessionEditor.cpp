@@ -1,5 +1,6 @@
 #include "SessionEditor.h"
 #include "Singletons.h"
+#include "FileCache.h"
 #include "SessionModel.h"
 #include "EditActions.h"
 #include "FileDialog.h"
@@ -251,6 +252,7 @@ bool SessionEditor::load()
     if (!mModel.load(mFileName))
         return false;
 
+    Singletons::fileCache().prefetchSessionFiles();
     return true;
 }
 
@@ -416,7 +416,7 @@ void TextureProperties::applyFileFormat()
 {
     const auto fileName = mUi->file->currentData().toString();
     auto texture = TextureData();
-    if (Singletons::fileCache().getTexture(fileName, false, &texture)) {
+    if (Singletons::fileCache().getTexture(fileName, &texture)) {
         setFormat(texture.format());
         mUi->target->setCurrentData(texture.target());
         mUi->width->setText(QString::number(texture.width()));